@@ -0,0 +1,194 @@
+/* Copyright (c) 2009-2014 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RCDB_LATENCYHISTOGRAM_H
+#define RCDB_LATENCYHISTOGRAM_H
+
+#include <stdint.h>
+#include <string.h>
+
+namespace RCDB {
+
+/**
+ * Fixed-size log-linear histogram of latencies in nanoseconds. Each power of
+ * two is split into 16 equal buckets, so any percentile read back is within
+ * about 3% of the true value. Histograms with the same layout merge exactly,
+ * which is what makes percentiles across threads and clients meaningful
+ * (unlike averaging per-thread percentiles).
+ *
+ * Recording is a handful of integer operations and touches one bucket, so it
+ * is cheap enough for every transaction.
+ */
+class LatencyHistogram {
+  public:
+    /// log2 of the number of buckets per power of two.
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    /// Values at or above 2^MAX_EXPONENT ns (about 39 hours) land in the
+    /// last bucket.
+    static const int MAX_EXPONENT = 47;
+    static const int NUM_BUCKETS =
+            SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+    LatencyHistogram()
+        : buckets()
+        , count(0)
+        , sum(0)
+        , min(0)
+        , max(0)
+    {
+    }
+
+    /// Forget all recorded values.
+    void
+    reset()
+    {
+        memset(buckets, 0, sizeof(buckets));
+        count = 0;
+        sum = 0;
+        min = 0;
+        max = 0;
+    }
+
+    /// Record one latency, in nanoseconds.
+    void
+    record(uint64_t ns)
+    {
+        buckets[bucketIndex(ns)]++;
+        if (count == 0 || ns < min)
+            min = ns;
+        if (ns > max)
+            max = ns;
+        count++;
+        sum += ns;
+    }
+
+    /// Add another histogram's values to this one.
+    void
+    merge(const LatencyHistogram& other)
+    {
+        for (int i = 0; i < NUM_BUCKETS; i++)
+            buckets[i] += other.buckets[i];
+        if (other.count > 0 && (count == 0 || other.min < min))
+            min = other.min;
+        if (other.max > max)
+            max = other.max;
+        count += other.count;
+        sum += other.sum;
+    }
+
+    /**
+     * Return the value below which the given fraction of recorded values
+     * fall, e.g. 0.99 for the 99th percentile. Returns 0 when empty.
+     */
+    uint64_t
+    getPercentile(double fraction) const
+    {
+        if (count == 0)
+            return 0;
+        uint64_t rank = (uint64_t)(fraction * (double)count + 0.5);
+        if (rank == 0)
+            rank = 1;
+        if (rank >= count)
+            return max;
+        uint64_t seen = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                // Report the middle of the bucket, clamped to what was seen.
+                uint64_t value = bucketLowerBound(i) + bucketWidth(i) / 2;
+                if (value > max)
+                    value = max;
+                if (value < min)
+                    value = min;
+                return value;
+            }
+        }
+        return max;
+    }
+
+    uint64_t getCount() const { return count; }
+    uint64_t getSum() const { return sum; }
+    uint64_t getMin() const { return min; }
+    uint64_t getMax() const { return max; }
+
+    double
+    getMean() const
+    {
+        return count == 0 ? 0.0 : (double)sum / (double)count;
+    }
+
+    /// Number of values recorded in bucket i.
+    uint64_t getBucket(int i) const { return buckets[i]; }
+
+    /**
+     * Add values directly to a bucket; used to rebuild a histogram that was
+     * written out bucket by bucket. The caller must also restore the summary
+     * fields with setSummary().
+     */
+    void addToBucket(int i, uint64_t n) { buckets[i] += n; }
+
+    void
+    setSummary(uint64_t count, uint64_t sum, uint64_t min, uint64_t max)
+    {
+        this->count = count;
+        this->sum = sum;
+        this->min = min;
+        this->max = max;
+    }
+
+    static int
+    bucketIndex(uint64_t ns)
+    {
+        if (ns < (uint64_t)SUB_BUCKETS)
+            return (int)ns;
+        int exponent = 63 - __builtin_clzll(ns);
+        if (exponent >= MAX_EXPONENT)
+            return NUM_BUCKETS - 1;
+        int sub = (int)((ns >> (exponent - SUB_BUCKET_BITS)) &
+                (SUB_BUCKETS - 1));
+        return SUB_BUCKETS + (exponent - SUB_BUCKET_BITS) * SUB_BUCKETS + sub;
+    }
+
+    static uint64_t
+    bucketLowerBound(int i)
+    {
+        if (i < SUB_BUCKETS)
+            return (uint64_t)i;
+        int exponent = (i - SUB_BUCKETS) / SUB_BUCKETS + SUB_BUCKET_BITS;
+        uint64_t sub = (uint64_t)((i - SUB_BUCKETS) % SUB_BUCKETS);
+        return ((uint64_t)SUB_BUCKETS + sub) << (exponent - SUB_BUCKET_BITS);
+    }
+
+    static uint64_t
+    bucketWidth(int i)
+    {
+        if (i < SUB_BUCKETS)
+            return 1;
+        int exponent = (i - SUB_BUCKETS) / SUB_BUCKETS + SUB_BUCKET_BITS;
+        return 1UL << (exponent - SUB_BUCKET_BITS);
+    }
+
+  private:
+    uint64_t buckets[NUM_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+};
+
+} // namespace RCDB
+
+#endif // RCDB_LATENCYHISTOGRAM_H
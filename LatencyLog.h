@@ -0,0 +1,294 @@
+/* Copyright (c) 2009-2014 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RCDB_LATENCYLOG_H
+#define RCDB_LATENCYLOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Binary per-transaction latency log. Each workload thread appends fixed-size
+ * LatencyLogRecords to its own LatencyLog, a single-producer/single-consumer
+ * ring, and a LatencyLogWriter thread drains all the rings to disk in the
+ * background. TwitterLatLogConvert turns the resulting .blat files into the
+ * text .lat format below.
+ */
+
+namespace RCDB {
+
+// USERID, TXTYPE, LATENCY
+#define LATFILE_HDRFMTSTR "%12s%12s%12s\n"
+#define LATFILE_ENTFMTSTR "%12lu%12s%12.2f\n"
+
+/// Number of per-operation slots in a record; matches NUM_STATS in the client.
+#define LATLOG_NUM_STAGES 10
+
+/// Transaction types recorded in LatencyLogRecord::txType; the same order
+/// as the client's txType.
+enum LatencyLogTxType {
+    LATLOG_TX_STREAM = 0,
+    LATLOG_TX_TWEET = 1,
+    LATLOG_TX_TIMELINE = 2,
+    LATLOG_TX_FOLLOW = 3,
+    LATLOG_TX_UNFOLLOW = 4,
+    LATLOG_TX_STREAMPAGE = 5,
+    LATLOG_TX_READTWEET = 6,
+    LATLOG_TX_STREAMSINCE = 7,
+    LATLOG_NUM_TX_TYPES
+};
+
+/// Short names written to the TXTYPE column of .lat and .ts files.
+static const char* const latLogTxTypeNames[LATLOG_NUM_TX_TYPES] = {
+    "ST",
+    "TW",
+    "TL",
+    "FO",
+    "UF",
+    "SP",
+    "RT",
+    "SS",
+};
+
+/**
+ * File header at the start of every .blat file. Carries what is needed to
+ * convert cycle counts in the records to time without access to the machine
+ * that produced them.
+ */
+struct LatencyLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    /// Cycles::perSecond() on the machine that wrote the log.
+    double cyclesPerSec;
+    /// Cycles::rdtsc() and wall clock (ns since the epoch) sampled together
+    /// when the log was opened, so record timestamps can be made absolute.
+    uint64_t startCycles;
+    uint64_t startWallTimeNs;
+    uint64_t serverNumber;
+    uint64_t threadNumber;
+};
+
+#define LATLOG_MAGIC "RCDBLAT"
+#define LATLOG_VERSION 1
+
+/**
+ * One transaction. Stage slots are indexed like the ops of the transaction
+ * type in the client's txTypes table; unused slots are zero.
+ */
+struct LatencyLogRecord {
+    /// Cycles::rdtsc() when the transaction started.
+    uint64_t timestamp;
+    uint64_t userId;
+    /// Total transaction latency in cycles.
+    uint64_t latency;
+    /// Latency of each RPC stage in cycles.
+    uint64_t stageLatency[LATLOG_NUM_STAGES];
+    /// Number of objects in each multi-op stage.
+    uint32_t multiOpSize[LATLOG_NUM_STAGES];
+    uint32_t txType;
+    uint32_t reserved;
+};
+
+/**
+ * Lock-free ring of LatencyLogRecords between one workload thread (the
+ * producer) and the LatencyLogWriter (the consumer), backed by one .blat
+ * file. The producer never blocks: if the writer falls so far behind that
+ * the ring is full, the record is dropped and counted instead.
+ */
+class LatencyLog {
+  public:
+    /**
+     * \param fileName
+     *      File to write records to; truncated if it exists.
+     * \param header
+     *      Header to write at the start of the file; magic, version and
+     *      recordSize are filled in here.
+     * \param capacity
+     *      Number of records the ring can hold; rounded up to a power of 2.
+     */
+    LatencyLog(const std::string& fileName, LatencyLogHeader header,
+            uint64_t capacity)
+        : file(fopen(fileName.c_str(), "w"))
+        , ring()
+        , mask(0)
+        , head(0)
+        , headPad()
+        , tail(0)
+        , tailPad()
+        , dropped(0)
+        , written(0)
+    {
+        uint64_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        ring.resize(size);
+        mask = size - 1;
+
+        if (file == NULL)
+            return;
+        memcpy(header.magic, LATLOG_MAGIC, sizeof(header.magic));
+        header.version = LATLOG_VERSION;
+        header.recordSize = sizeof(LatencyLogRecord);
+        fwrite(&header, sizeof(header), 1, file);
+    }
+
+    ~LatencyLog()
+    {
+        if (file != NULL)
+            fclose(file);
+    }
+
+    /// False if the backing file could not be opened.
+    bool isOpen() const { return file != NULL; }
+
+    /**
+     * Add a record to the ring. Called only by the owning workload thread.
+     *
+     * \return
+     *      False if the ring was full and the record was dropped.
+     */
+    bool
+    append(const LatencyLogRecord& record)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask) {
+            dropped++;
+            return false;
+        }
+        ring[h & mask] = record;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Write every record currently in the ring to the file. Called only by
+     * the LatencyLogWriter.
+     *
+     * \return
+     *      Number of records written.
+     */
+    uint64_t
+    drain()
+    {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        uint64_t count = h - t;
+        while (t != h) {
+            // Write up to the end of the ring in one go, then wrap.
+            uint64_t start = t & mask;
+            uint64_t n = std::min(h - t, mask + 1 - start);
+            if (file != NULL)
+                fwrite(&ring[start], sizeof(LatencyLogRecord), n, file);
+            t += n;
+        }
+        tail.store(t, std::memory_order_release);
+        written += count;
+        return count;
+    }
+
+    /// Records dropped because the ring was full. Only meaningful once the
+    /// producer has stopped.
+    uint64_t getDropped() const { return dropped; }
+
+    /// Records written to the file so far.
+    uint64_t getWritten() const { return written; }
+
+  private:
+    FILE* file;
+    std::vector<LatencyLogRecord> ring;
+    uint64_t mask;
+
+    /// Next slot the producer will fill; padded so the producer and
+    /// consumer indexes live on separate cache lines.
+    std::atomic<uint64_t> head;
+    char headPad[64 - sizeof(std::atomic<uint64_t>)];
+
+    /// Next slot the consumer will drain.
+    std::atomic<uint64_t> tail;
+    char tailPad[64 - sizeof(std::atomic<uint64_t>)];
+
+    /// Producer-side count of records that did not fit.
+    uint64_t dropped;
+
+    /// Consumer-side count of records written.
+    uint64_t written;
+
+    LatencyLog(const LatencyLog&);
+    LatencyLog& operator=(const LatencyLog&);
+};
+
+/**
+ * Background thread that periodically drains a set of LatencyLogs to disk.
+ * Destroying the writer stops the thread after a final drain, so it should
+ * be destroyed only after the workload threads have finished.
+ */
+class LatencyLogWriter {
+  public:
+    /**
+     * \param logs
+     *      Logs to drain; they must outlive the writer.
+     * \param pollIntervalUs
+     *      How long to sleep when there was nothing to write.
+     */
+    explicit LatencyLogWriter(const std::vector<LatencyLog*>& logs,
+            uint32_t pollIntervalUs = 1000)
+        : logs(logs)
+        , pollIntervalUs(pollIntervalUs)
+        , stop(false)
+        , thread(&LatencyLogWriter::main, this)
+    {
+    }
+
+    ~LatencyLogWriter()
+    {
+        stop.store(true, std::memory_order_release);
+        thread.join();
+        for (size_t i = 0; i < logs.size(); i++)
+            logs[i]->drain();
+    }
+
+  private:
+    void
+    main()
+    {
+        while (!stop.load(std::memory_order_acquire)) {
+            uint64_t count = 0;
+            for (size_t i = 0; i < logs.size(); i++)
+                count += logs[i]->drain();
+            if (count == 0)
+                usleep(pollIntervalUs);
+        }
+    }
+
+    std::vector<LatencyLog*> logs;
+    uint32_t pollIntervalUs;
+    std::atomic<bool> stop;
+    std::thread thread;
+
+    LatencyLogWriter(const LatencyLogWriter&);
+    LatencyLogWriter& operator=(const LatencyLogWriter&);
+};
+
+} // namespace RCDB
+
+#endif // RCDB_LATENCYLOG_H
@@ -0,0 +1,652 @@
+/* Copyright (c) 2009-2014 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RCDB_RUNSUMMARY_H
+#define RCDB_RUNSUMMARY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "LatencyHistogram.h"
+
+/*
+ * Mergeable summary of a measurement window, written by each
+ * TwitterWorkloadClient as sNN.sum and combined across clients by
+ * TwitterResultMerge. Everything in it is a sum, a max, or a histogram, so
+ * merging is exact: cluster throughput is the sum of client throughputs and
+ * cluster percentiles come from the merged histograms, never from averaging
+ * per-client numbers.
+ *
+ * The file is line-oriented text:
+ *
+ *   RCDBSUM <version>
+ *   clients <n>
+ *   threads <n>
+ *   window <measureTime> <totalTime>
+ *   start <firstStartTime> <lastStartTime>
+ *   busy <clientBusy> <maxClientBusy> <dispatchThreads>
+ *   tx <txType> <count> <totalNs> <throughput>
+ *   hist <txType> <count> <sum> <min> <max> <bucket>:<n> ...
+ *   op <txType> <opName> <opCount> <totalNs> <keyBytes> <valueBytes>
+ *       <multiOpSize> <rejectCount> <flags>
+ *   master <serviceLocator> <opCount> <keyBytes> <valueBytes> <rpcCount>
+ *       <rpcNs>
+ *   masterhist <serviceLocator> <count> <sum> <min> <max> <bucket>:<n> ...
+ *   interval <index> <txType> <phase> <endTime> <elapsed> <seconds>
+ *       <throughput> <count> <sum> <min> <max> <bucket>:<n> ...
+ *
+ * Interval lines (version 2) carry the --reportInterval time series with its
+ * histograms, so per-client and cluster time series can be merged exactly as
+ * well; writeTimeSeries() prints them in the per-thread .ts format.
+ */
+
+namespace RCDB {
+
+#define RUNSUMMARY_MAGIC "RCDBSUM"
+#define RUNSUMMARY_VERSION 2
+
+// .ts time series rows, one per report interval and transaction type:
+// EPOCH, ELAPSED, PHASE, TXTYPE, COUNT, TPUT, AVG, P50, P90, P99, P999, MAX
+#define TSFILE_HDRFMTSTR "%18s%12s%6s%8s%12s%12s%12s%12s%12s%12s%12s%12s\n"
+#define TSFILE_ENTFMTSTR "%18.3f%12.3f%6s%8s%12lu%12.2f%12.2f%12.2f%12.2f%12.2f%12.2f%12.2f\n"
+
+/// Totals for one transaction type.
+struct RunSummaryTx {
+    std::string name;
+    uint64_t count;
+    /// Sum of transaction latencies.
+    uint64_t totalNs;
+    /// Transactions per second; summed, not averaged, when merging.
+    double throughput;
+    LatencyHistogram hist;
+
+    RunSummaryTx()
+        : name()
+        , count(0)
+        , totalNs(0)
+        , throughput(0.0)
+        , hist()
+    {
+    }
+};
+
+/// Totals for one RPC stage of one transaction type.
+// How a stage's statistics are reported.
+#define OP_MULTI    0x1 // Multi-op: bytes are per object, report the size.
+#define OP_NOBYTES  0x2 // No key or value bytes worth reporting.
+#define OP_REJECTS  0x4 // Report rejected writes or missing objects.
+
+struct RunSummaryOp {
+    std::string txName;
+    std::string name;
+    /// OP_* flags of the stage. Op lines of older files have none; those
+    /// are read as OP_REJECTS, plus OP_MULTI if the stage is a multi-op.
+    int flags;
+    uint64_t opCount;
+    uint64_t totalNs;
+    uint64_t keyBytes;
+    uint64_t valueBytes;
+    /// Total objects over all multi-op calls; 0 for single-object ops.
+    uint64_t multiOpSize;
+    uint64_t rejectCount;
+
+    RunSummaryOp()
+        : txName()
+        , name()
+        , flags(0)
+        , opCount(0)
+        , totalNs(0)
+        , keyBytes(0)
+        , valueBytes(0)
+        , multiOpSize(0)
+        , rejectCount(0)
+    {
+    }
+};
+
+/// Load on one master, present only if the client ran with --perMasterStats.
+struct RunSummaryMaster {
+    std::string locator;
+    /// Objects accessed, whether by single-object RPCs or multi-op entries.
+    uint64_t opCount;
+    uint64_t keyBytes;
+    uint64_t valueBytes;
+    /// Single-object RPCs, the sum of their latencies and their latency
+    /// histogram, in nanoseconds.
+    uint64_t rpcCount;
+    uint64_t rpcNs;
+    LatencyHistogram rpcHist;
+
+    RunSummaryMaster()
+        : locator()
+        , opCount(0)
+        , keyBytes(0)
+        , valueBytes(0)
+        , rpcCount(0)
+        , rpcNs(0)
+        , rpcHist()
+    {
+    }
+};
+
+/**
+ * Transactions of one type that completed in one report interval. Each thread
+ * numbers its intervals from the start of its run, so merged intervals line
+ * up as closely as the threads' starts do (see --startBarrier). The
+ * histogram is kept sparse, since a run has many intervals.
+ */
+struct RunSummaryInterval {
+    uint64_t index;
+    std::string txName;
+    /// Run phase (W, M or C) at the end of the interval.
+    std::string phase;
+    /// Wall clock time (seconds since the epoch) and seconds since the run
+    /// started at the end of the interval, and its length; merged intervals
+    /// keep the max.
+    double endTime;
+    double elapsed;
+    double seconds;
+    /// Transactions per second; summed, not averaged, when merging.
+    double throughput;
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    /// The histogram's non-empty buckets, in bucket order.
+    std::vector<std::pair<int, uint64_t> > buckets;
+
+    RunSummaryInterval()
+        : index(0)
+        , txName()
+        , phase()
+        , endTime(0.0)
+        , elapsed(0.0)
+        , seconds(0.0)
+        , throughput(0.0)
+        , count(0)
+        , sum(0)
+        , min(0)
+        , max(0)
+        , buckets()
+    {
+    }
+
+    /// Take the latencies from a histogram.
+    void
+    setHistogram(const LatencyHistogram& hist)
+    {
+        count = hist.getCount();
+        sum = hist.getSum();
+        min = hist.getMin();
+        max = hist.getMax();
+        buckets.clear();
+        for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; b++)
+            if (hist.getBucket(b) != 0)
+                buckets.push_back(std::make_pair(b, hist.getBucket(b)));
+    }
+
+    LatencyHistogram
+    getHistogram() const
+    {
+        LatencyHistogram hist;
+        hist.setSummary(count, sum, min, max);
+        for (size_t i = 0; i < buckets.size(); i++)
+            hist.addToBucket(buckets[i].first, buckets[i].second);
+        return hist;
+    }
+
+    /// Add the same interval of another thread or client.
+    void
+    merge(const RunSummaryInterval& other)
+    {
+        if (phase.empty())
+            phase = other.phase;
+        endTime = std::max(endTime, other.endTime);
+        elapsed = std::max(elapsed, other.elapsed);
+        seconds = std::max(seconds, other.seconds);
+        throughput += other.throughput;
+        if (other.count > 0 && (count == 0 || other.min < min))
+            min = other.min;
+        max = std::max(max, other.max);
+        count += other.count;
+        sum += other.sum;
+
+        std::vector<std::pair<int, uint64_t> > merged;
+        size_t i = 0, j = 0;
+        while (i < buckets.size() || j < other.buckets.size()) {
+            if (j == other.buckets.size() || (i < buckets.size() &&
+                    buckets[i].first < other.buckets[j].first)) {
+                merged.push_back(buckets[i++]);
+            } else if (i == buckets.size() ||
+                    other.buckets[j].first < buckets[i].first) {
+                merged.push_back(other.buckets[j++]);
+            } else {
+                merged.push_back(std::make_pair(buckets[i].first,
+                        buckets[i].second + other.buckets[j].second));
+                i++;
+                j++;
+            }
+        }
+        buckets.swap(merged);
+    }
+};
+
+class RunSummary {
+  public:
+    RunSummary()
+        : numClients(0)
+        , numThreads(0)
+        , measureTime(0.0)
+        , totalTime(0.0)
+        , firstStartTime(0.0)
+        , lastStartTime(0.0)
+        , clientBusy(0.0)
+        , maxClientBusy(0.0)
+        , dispatchThreads(0)
+        , txs()
+        , ops()
+        , masters()
+        , intervals()
+    {
+    }
+
+    /// Return the entry for a transaction type, adding it if necessary.
+    RunSummaryTx&
+    tx(const std::string& name)
+    {
+        for (size_t i = 0; i < txs.size(); i++)
+            if (txs[i].name == name)
+                return txs[i];
+        txs.push_back(RunSummaryTx());
+        txs.back().name = name;
+        return txs.back();
+    }
+
+    /// Return the entry for a stage, adding it if necessary.
+    RunSummaryOp&
+    op(const std::string& txName, const std::string& name)
+    {
+        for (size_t i = 0; i < ops.size(); i++)
+            if (ops[i].txName == txName && ops[i].name == name)
+                return ops[i];
+        ops.push_back(RunSummaryOp());
+        ops.back().txName = txName;
+        ops.back().name = name;
+        return ops.back();
+    }
+
+    /// Return the entry for a master, adding it if necessary.
+    RunSummaryMaster&
+    master(const std::string& locator)
+    {
+        for (size_t i = 0; i < masters.size(); i++)
+            if (masters[i].locator == locator)
+                return masters[i];
+        masters.push_back(RunSummaryMaster());
+        masters.back().locator = locator;
+        return masters.back();
+    }
+
+    /**
+     * Add an interval of a thread or client, merging it into the one with
+     * the same index and transaction type if there is one.
+     */
+    void
+    addInterval(const RunSummaryInterval& from)
+    {
+        IntervalKey key(from.index, from.txName);
+        std::map<IntervalKey, RunSummaryInterval>::iterator it =
+                intervals.find(key);
+        if (it == intervals.end())
+            intervals[key] = from;
+        else
+            it->second.merge(from);
+    }
+
+    /// Add another summary, e.g. another client's, into this one.
+    void
+    merge(const RunSummary& other)
+    {
+        numClients += other.numClients;
+        numThreads += other.numThreads;
+        measureTime = std::max(measureTime, other.measureTime);
+        totalTime = std::max(totalTime, other.totalTime);
+        if (firstStartTime == 0.0 || other.firstStartTime < firstStartTime)
+            firstStartTime = other.firstStartTime;
+        lastStartTime = std::max(lastStartTime, other.lastStartTime);
+        clientBusy += other.clientBusy;
+        maxClientBusy = std::max(maxClientBusy, other.maxClientBusy);
+        dispatchThreads += other.dispatchThreads;
+        for (size_t i = 0; i < other.txs.size(); i++) {
+            const RunSummaryTx& from = other.txs[i];
+            RunSummaryTx& into = tx(from.name);
+            into.count += from.count;
+            into.totalNs += from.totalNs;
+            into.throughput += from.throughput;
+            into.hist.merge(from.hist);
+        }
+        for (size_t i = 0; i < other.ops.size(); i++) {
+            const RunSummaryOp& from = other.ops[i];
+            RunSummaryOp& into = op(from.txName, from.name);
+            into.flags |= from.flags;
+            into.opCount += from.opCount;
+            into.totalNs += from.totalNs;
+            into.keyBytes += from.keyBytes;
+            into.valueBytes += from.valueBytes;
+            into.multiOpSize += from.multiOpSize;
+            into.rejectCount += from.rejectCount;
+        }
+        for (size_t i = 0; i < other.masters.size(); i++) {
+            const RunSummaryMaster& from = other.masters[i];
+            RunSummaryMaster& into = master(from.locator);
+            into.opCount += from.opCount;
+            into.keyBytes += from.keyBytes;
+            into.valueBytes += from.valueBytes;
+            into.rpcCount += from.rpcCount;
+            into.rpcNs += from.rpcNs;
+            into.rpcHist.merge(from.rpcHist);
+        }
+        for (std::map<IntervalKey, RunSummaryInterval>::const_iterator it =
+                other.intervals.begin(); it != other.intervals.end(); it++)
+            addInterval(it->second);
+    }
+
+    /// Write the summary in the .sum format. Returns false on I/O error.
+    bool
+    write(const std::string& fileName) const
+    {
+        FILE* f = fopen(fileName.c_str(), "w");
+        if (f == NULL)
+            return false;
+        fprintf(f, "%s %d\n", RUNSUMMARY_MAGIC, RUNSUMMARY_VERSION);
+        fprintf(f, "clients %lu\n", numClients);
+        fprintf(f, "threads %lu\n", numThreads);
+        fprintf(f, "window %0.6f %0.6f\n", measureTime, totalTime);
+        fprintf(f, "start %0.6f %0.6f\n", firstStartTime, lastStartTime);
+        fprintf(f, "busy %0.6f %0.6f %lu\n", clientBusy, maxClientBusy,
+                dispatchThreads);
+        for (size_t i = 0; i < txs.size(); i++) {
+            const RunSummaryTx& t = txs[i];
+            fprintf(f, "tx %s %lu %lu %0.6f\n", t.name.c_str(), t.count,
+                    t.totalNs, t.throughput);
+            fprintf(f, "hist %s", t.name.c_str());
+            writeHistogram(f, t.hist);
+        }
+        for (size_t i = 0; i < ops.size(); i++) {
+            const RunSummaryOp& o = ops[i];
+            fprintf(f, "op %s %s %lu %lu %lu %lu %lu %lu %d\n",
+                    o.txName.c_str(), o.name.c_str(), o.opCount, o.totalNs,
+                    o.keyBytes, o.valueBytes, o.multiOpSize, o.rejectCount,
+                    o.flags);
+        }
+        for (size_t i = 0; i < masters.size(); i++) {
+            const RunSummaryMaster& m = masters[i];
+            fprintf(f, "master %s %lu %lu %lu %lu %lu\n", m.locator.c_str(),
+                    m.opCount, m.keyBytes, m.valueBytes, m.rpcCount, m.rpcNs);
+            fprintf(f, "masterhist %s", m.locator.c_str());
+            writeHistogram(f, m.rpcHist);
+        }
+        for (std::map<IntervalKey, RunSummaryInterval>::const_iterator it =
+                intervals.begin(); it != intervals.end(); it++) {
+            const RunSummaryInterval& v = it->second;
+            fprintf(f, "interval %lu %s %s %0.6f %0.6f %0.6f %0.6f "
+                    "%lu %lu %lu %lu", v.index, v.txName.c_str(),
+                    v.phase.c_str(), v.endTime, v.elapsed, v.seconds,
+                    v.throughput, v.count, v.sum, v.min, v.max);
+            for (size_t b = 0; b < v.buckets.size(); b++)
+                fprintf(f, " %d:%lu", v.buckets[b].first, v.buckets[b].second);
+            fprintf(f, "\n");
+        }
+        bool ok = !ferror(f);
+        return fclose(f) == 0 && ok;
+    }
+
+    /**
+     * Write the intervals as a .ts time series, in the same format as each
+     * workload thread's. Returns false on I/O error.
+     */
+    bool
+    writeTimeSeries(const std::string& fileName) const
+    {
+        FILE* f = fopen(fileName.c_str(), "w");
+        if (f == NULL)
+            return false;
+        fprintf(f, TSFILE_HDRFMTSTR, "#EPOCH(s)", "ELAPSED(s)", "PHASE",
+                "TXTYPE", "COUNT", "TPUT(tx/s)", "AVG(us)", "P50(us)",
+                "P90(us)", "P99(us)", "P999(us)", "MAX(us)");
+        for (std::map<IntervalKey, RunSummaryInterval>::const_iterator it =
+                intervals.begin(); it != intervals.end(); it++) {
+            const RunSummaryInterval& v = it->second;
+            LatencyHistogram h = v.getHistogram();
+            fprintf(f, TSFILE_ENTFMTSTR, v.endTime, v.elapsed,
+                    v.phase.c_str(), v.txName.c_str(), h.getCount(),
+                    v.throughput, h.getMean() / 1000.0,
+                    (double)h.getPercentile(0.5) / 1000.0,
+                    (double)h.getPercentile(0.9) / 1000.0,
+                    (double)h.getPercentile(0.99) / 1000.0,
+                    (double)h.getPercentile(0.999) / 1000.0,
+                    (double)h.getMax() / 1000.0);
+        }
+        bool ok = !ferror(f);
+        return fclose(f) == 0 && ok;
+    }
+
+    /**
+     * Read a .sum file into this (empty) summary.
+     *
+     * \param[out] error
+     *      Set to a description of the problem if false is returned.
+     */
+    bool
+    read(const std::string& fileName, std::string* error)
+    {
+        FILE* f = fopen(fileName.c_str(), "r");
+        if (f == NULL) {
+            *error = "could not open " + fileName;
+            return false;
+        }
+
+        std::string line;
+        char name[256], opName[256], locator[1024], phase[16];
+        int version = 0;
+        // Version 1 files are the same without interval lines.
+        bool ok = readLine(f, &line) &&
+                sscanf(line.c_str(), RUNSUMMARY_MAGIC " %d", &version) == 1 &&
+                version >= 1 && version <= RUNSUMMARY_VERSION;
+        if (!ok)
+            *error = fileName + " is not a supported run summary";
+
+        while (ok && readLine(f, &line)) {
+            const char* l = line.c_str();
+            int pos = 0;
+            if (line.empty() || line[0] == '#') {
+                continue;
+            } else if (sscanf(l, "clients %lu", &numClients) == 1 ||
+                    sscanf(l, "threads %lu", &numThreads) == 1 ||
+                    sscanf(l, "window %lf %lf", &measureTime,
+                            &totalTime) == 2 ||
+                    sscanf(l, "start %lf %lf", &firstStartTime,
+                            &lastStartTime) == 2 ||
+                    sscanf(l, "busy %lf %lf %lu", &clientBusy,
+                            &maxClientBusy, &dispatchThreads) == 3) {
+                continue;
+            } else if (strncmp(l, "cpu ", 4) == 0) {
+                // Thread CPU time of version 1 files, which measured RPC
+                // polling as well; not comparable, so not reported.
+                continue;
+            } else if (strncmp(l, "tx ", 3) == 0) {
+                uint64_t count, totalNs;
+                double throughput;
+                ok = sscanf(l, "tx %255s %lu %lu %lf", name, &count,
+                        &totalNs, &throughput) == 4;
+                if (ok) {
+                    RunSummaryTx& t = tx(name);
+                    t.count = count;
+                    t.totalNs = totalNs;
+                    t.throughput = throughput;
+                }
+            } else if (strncmp(l, "hist ", 5) == 0) {
+                ok = sscanf(l, "hist %255s%n", name, &pos) == 1 &&
+                        readHistogram(l + pos, &tx(name).hist);
+            } else if (strncmp(l, "masterhist ", 11) == 0) {
+                ok = sscanf(l, "masterhist %1023s%n", locator, &pos) == 1 &&
+                        readHistogram(l + pos, &master(locator).rpcHist);
+            } else if (strncmp(l, "op ", 3) == 0) {
+                RunSummaryOp o;
+                int fields = sscanf(l, "op %255s %255s %lu %lu %lu %lu %lu %lu "
+                        "%d", name, opName, &o.opCount, &o.totalNs,
+                        &o.keyBytes, &o.valueBytes, &o.multiOpSize,
+                        &o.rejectCount, &o.flags);
+                ok = fields >= 8;
+                if (fields == 8)
+                    o.flags = OP_REJECTS | (o.multiOpSize > 0 ? OP_MULTI : 0);
+                if (ok) {
+                    RunSummaryOp& into = op(name, opName);
+                    o.txName = into.txName;
+                    o.name = into.name;
+                    into = o;
+                }
+            } else if (strncmp(l, "master ", 7) == 0) {
+                RunSummaryMaster m;
+                ok = sscanf(l, "master %1023s %lu %lu %lu %lu %lu", locator,
+                        &m.opCount, &m.keyBytes, &m.valueBytes, &m.rpcCount,
+                        &m.rpcNs) == 6;
+                if (ok) {
+                    RunSummaryMaster& into = master(locator);
+                    m.locator = into.locator;
+                    m.rpcHist = into.rpcHist;
+                    into = m;
+                }
+            } else if (strncmp(l, "interval ", 9) == 0) {
+                RunSummaryInterval v;
+                ok = sscanf(l, "interval %lu %255s %15s %lf %lf %lf %lf "
+                        "%lu %lu %lu %lu%n", &v.index, name, phase,
+                        &v.endTime, &v.elapsed, &v.seconds, &v.throughput,
+                        &v.count, &v.sum, &v.min, &v.max, &pos) == 11;
+                if (ok) {
+                    v.txName = name;
+                    v.phase = phase;
+                    ok = readBuckets(l + pos, &v.buckets);
+                    if (ok)
+                        addInterval(v);
+                }
+            } else {
+                ok = false;
+            }
+            if (!ok)
+                *error = fileName + ": cannot parse \"" + line + "\"";
+        }
+        fclose(f);
+        return ok;
+    }
+
+    /// Number of client processes merged into this summary.
+    uint64_t numClients;
+    /// Number of workload threads merged into this summary.
+    uint64_t numThreads;
+    /// Length of the measurement window in seconds (max over merged parts).
+    double measureTime;
+    /// Length of the whole run in seconds (max over merged parts).
+    double totalTime;
+    /// Earliest and latest wall clock start (seconds since the epoch) of
+    /// any merged thread; their difference is the measurement window skew.
+    /// Across machines this is only as accurate as their clock sync.
+    double firstStartTime;
+    double lastStartTime;
+    /// Sum over the merged threads of the fraction of the measurement
+    /// window each spent generating and processing transactions rather than
+    /// waiting for RPCs (or replay times), and the largest such fraction.
+    /// The average is clientBusy / numThreads; near 100% the clients, not
+    /// the servers, limit throughput.
+    double clientBusy;
+    double maxClientBusy;
+    /// Dispatch threads of clients shared through --threadsPerContext. Each
+    /// spins on a core of its own, which the threads' busy time leaves out.
+    uint64_t dispatchThreads;
+    /// Transaction types, in the order first seen.
+    std::vector<RunSummaryTx> txs;
+    /// Stages, in the order first seen.
+    std::vector<RunSummaryOp> ops;
+    /// Masters, in the order first seen.
+    std::vector<RunSummaryMaster> masters;
+    /// Report intervals, by index and then transaction type.
+    typedef std::pair<uint64_t, std::string> IntervalKey;
+    std::map<IntervalKey, RunSummaryInterval> intervals;
+
+  private:
+    /// Write " <count> <sum> <min> <max> <bucket>:<n> ..." and end the line.
+    static void
+    writeHistogram(FILE* f, const LatencyHistogram& hist)
+    {
+        fprintf(f, " %lu %lu %lu %lu", hist.getCount(), hist.getSum(),
+                hist.getMin(), hist.getMax());
+        for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; b++)
+            if (hist.getBucket(b) != 0)
+                fprintf(f, " %d:%lu", b, hist.getBucket(b));
+        fprintf(f, "\n");
+    }
+
+    /// Parse what writeHistogram() wrote, replacing hist.
+    static bool
+    readHistogram(const char* l, LatencyHistogram* hist)
+    {
+        uint64_t count, sum, min, max;
+        int pos = 0;
+        std::vector<std::pair<int, uint64_t> > buckets;
+        if (sscanf(l, " %lu %lu %lu %lu%n", &count, &sum, &min, &max,
+                &pos) != 4 || !readBuckets(l + pos, &buckets))
+            return false;
+        hist->reset();
+        hist->setSummary(count, sum, min, max);
+        for (size_t i = 0; i < buckets.size(); i++)
+            hist->addToBucket(buckets[i].first, buckets[i].second);
+        return true;
+    }
+
+    /// Parse the " <bucket>:<n> ..." list that ends histogram lines.
+    static bool
+    readBuckets(const char* l, std::vector<std::pair<int, uint64_t> >* buckets)
+    {
+        int bucket, n;
+        uint64_t bucketCount;
+        while (sscanf(l, " %d:%lu%n", &bucket, &bucketCount, &n) == 2) {
+            if (bucket < 0 || bucket >= LatencyHistogram::NUM_BUCKETS)
+                return false;
+            buckets->push_back(std::make_pair(bucket, bucketCount));
+            l += n;
+        }
+        return true;
+    }
+
+    static bool
+    readLine(FILE* f, std::string* line)
+    {
+        line->clear();
+        int c;
+        while ((c = fgetc(f)) != EOF && c != '\n')
+            line->push_back((char)c);
+        return c != EOF || !line->empty();
+    }
+};
+
+} // namespace RCDB
+
+#endif // RCDB_RUNSUMMARY_H
@@ -0,0 +1,49 @@
+/* Copyright (c) 2009-2014 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RCDB_TWEETTIME_H
+#define RCDB_TWEETTIME_H
+
+#include <stdint.h>
+
+/*
+ * Tweet times follow from tweet IDs: the dataset starts at
+ * STARTING_TWEET_TIME and adds TWEETS_PER_SECOND tweets per second. The
+ * loader and the workload client both use these, so the DATA times and
+ * STREAMBUCKET keys one writes are the ones the other looks for.
+ */
+
+namespace RCDB {
+
+#define STARTING_TWEET_TIME 1230800000UL
+#define TWEETS_PER_SECOND 1000UL
+
+/// Time of a tweet, in seconds since the epoch.
+inline uint64_t
+tweetTime(uint64_t tweetId)
+{
+    return STARTING_TWEET_TIME + tweetId / TWEETS_PER_SECOND;
+}
+
+/// STREAMBUCKET a tweet belongs in, for buckets of bucketSeconds.
+inline uint64_t
+streamBucket(uint64_t tweetId, uint64_t bucketSeconds)
+{
+    return tweetTime(tweetId) / bucketSeconds;
+}
+
+} // namespace RCDB
+
+#endif // RCDB_TWEETTIME_H
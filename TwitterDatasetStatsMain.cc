@@ -0,0 +1,311 @@
+/* Copyright (c) 2009-2014 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Reports the shape of a loaded dataset: object counts and bytes per table
+ * and per column, the length distributions of the FOLLOWERS, STREAM,
+ * STREAMBUCKET and TWEETS lists, and the users with the most followers. UserTable and
+ * TweetTable are enumerated in parallel, each by its own client. Lengths are
+ * per object, so a list split into parts counts once per part; the most
+ * followed users are ranked by their whole FOLLOWERS list.
+ *
+ *   TwitterDatasetStats -C <coordinator> [--topK 10]
+ *
+ * The report is printed to stdout.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "Cycles.h"
+#include "ShortMacros.h"
+#include "OptionParser.h"
+#include "RamCloud.h"
+#include "TableEnumerator.h"
+
+#include "RCDB.pb.h"
+#include "LatencyHistogram.h"
+
+using namespace RAMCloud;
+
+// Indexed by RCDB::ProtoBuf::Key::ColumnType; keys that do not parse as a
+// Key are counted under UNKNOWN.
+#define NUM_COLUMNS 6
+const char* columnNames[NUM_COLUMNS] = {"UNKNOWN", "TWEETS", "FOLLOWERS", "STREAM", "DATA", "STREAMBUCKET"};
+
+// Lengths are bucketed by powers of two: 0, 1, 2-3, 4-7, ...
+#define NUM_LENGTH_BUCKETS 34
+
+typedef std::pair<uint64_t, uint64_t> userWeight;
+
+/*
+ * Everything learned from enumerating one table.
+ */
+struct tableScan {
+    tableScan()
+        : objects(0)
+        , keyBytes(0)
+        , valueBytes(0)
+        , columnObjects()
+        , columnKeyBytes()
+        , columnValueBytes()
+        , partObjects(0)
+        , listHist()
+        , listBuckets()
+        , splitFollowers()
+        , topFollowed()
+        , scanTime(0.0)
+    {
+    }
+
+    uint64_t objects;
+    uint64_t keyBytes;
+    uint64_t valueBytes;
+    uint64_t columnObjects[NUM_COLUMNS];
+    uint64_t columnKeyBytes[NUM_COLUMNS];
+    uint64_t columnValueBytes[NUM_COLUMNS];
+    // Continuation parts of lists too long for one object (Key.part > 0).
+    uint64_t partObjects;
+    // Lengths of the ID lists in each column, in IDs. LatencyHistogram
+    // serves for any non-negative value, not just nanoseconds.
+    RCDB::LatencyHistogram listHist[NUM_COLUMNS];
+    uint64_t listBuckets[NUM_COLUMNS][NUM_LENGTH_BUCKETS];
+    // Followers in the continuation parts of split FOLLOWERS lists, by user.
+    std::map<uint64_t, uint64_t> splitFollowers;
+    // The topK users with the most followers, counting all parts of their
+    // lists, as (followers, userId) from the most followed down.
+    std::vector<userWeight> topFollowed;
+    double scanTime;
+};
+
+int
+lengthBucket(uint64_t length) {
+    int bucket = (length == 0) ? 0 : 64 - __builtin_clzll(length);
+    return std::min(bucket, NUM_LENGTH_BUCKETS - 1);
+}
+
+/*
+ * Enumerate one table with a client of its own and collect its statistics.
+ */
+void
+scanTable(OptionParser& optionParser, string tableName, uint64_t topK,
+        tableScan* scan) {
+    // need external context to set log levels with OptionParser
+    Context context(false);
+    RamCloud client(&context,
+            optionParser.options.getCoordinatorLocator().c_str(),
+            optionParser.options.getClusterName().c_str());
+
+    uint64_t tableId = client.getTableId(tableName.c_str());
+    LOG(NOTICE, "Scanning %s (id %lu)...", tableName.c_str(), tableId);
+
+    // The topK largest unsplit lengths seen, least on top so that it is the
+    // one replaced. Split lists are ranked once all their parts are known.
+    std::priority_queue<userWeight, std::vector<userWeight>, std::greater<userWeight> > topLengths;
+
+    RCDB::ProtoBuf::Key key;
+    uint64_t start = Cycles::rdtsc();
+    TableEnumerator enumerator(client, tableId, false);
+    while (enumerator.hasNext()) {
+        uint32_t keyLength;
+        const void* keyData;
+        uint32_t dataLength;
+        const void* data;
+        enumerator.nextKeyAndData(&keyLength, &keyData, &dataLength, &data);
+
+        uint64_t column = 0;
+        bool part = false;
+        if (key.ParseFromArray(keyData, (int)keyLength)) {
+            column = (uint64_t)key.column();
+            part = key.part() > 0;
+        }
+        if (column >= NUM_COLUMNS)
+            column = 0;
+        if (part)
+            scan->partObjects++;
+
+        scan->objects++;
+        scan->keyBytes += keyLength;
+        scan->valueBytes += dataLength;
+        scan->columnObjects[column]++;
+        scan->columnKeyBytes[column] += keyLength;
+        scan->columnValueBytes[column] += dataLength;
+
+        if (column == RCDB::ProtoBuf::Key::TWEETS ||
+                column == RCDB::ProtoBuf::Key::FOLLOWERS ||
+                column == RCDB::ProtoBuf::Key::STREAM ||
+                column == RCDB::ProtoBuf::Key::STREAMBUCKET) {
+            uint64_t length = dataLength / sizeof(uint64_t);
+            scan->listHist[column].record(length);
+            scan->listBuckets[column][lengthBucket(length)]++;
+            if (column == RCDB::ProtoBuf::Key::FOLLOWERS && topK > 0) {
+                if (part) {
+                    scan->splitFollowers[key.id()] += length;
+                } else {
+                    topLengths.push(userWeight(length, key.id()));
+                    if (topLengths.size() > topK)
+                        topLengths.pop();
+                }
+            }
+        }
+
+        if (scan->objects % 1000000 == 0)
+            LOG(NOTICE, "%s: %lu objects scanned (%0.0f objects/s)", tableName.c_str(), scan->objects, (double)scan->objects / Cycles::toSeconds(Cycles::rdtsc() - start));
+    }
+    scan->scanTime = Cycles::toSeconds(Cycles::rdtsc() - start);
+    LOG(NOTICE, "Scanned %s: %lu objects in %0.2fs", tableName.c_str(), scan->objects, scan->scanTime);
+
+    // Add the parts of split lists to their first part. A user left out of
+    // topLengths is not split and has no more followers than any user in it,
+    // so the candidates are the users in topLengths plus the split ones.
+    std::map<uint64_t, uint64_t> candidates;
+    while (!topLengths.empty()) {
+        candidates[topLengths.top().second] = topLengths.top().first;
+        topLengths.pop();
+    }
+    for (std::map<uint64_t, uint64_t>::const_iterator it = scan->splitFollowers.begin(); it != scan->splitFollowers.end(); it++) {
+        uint64_t firstPart = 0;
+        std::map<uint64_t, uint64_t>::const_iterator found = candidates.find(it->first);
+        if (found != candidates.end()) {
+            firstPart = found->second;
+        } else {
+            RCDB::ProtoBuf::Key firstKey;
+            firstKey.set_id(it->first);
+            firstKey.set_column(RCDB::ProtoBuf::Key::FOLLOWERS);
+            string keyString = firstKey.SerializeAsString();
+            Buffer buf;
+            try {
+                client.read(tableId, keyString.c_str(), (uint16_t)keyString.length(), &buf);
+                firstPart = buf.size() / sizeof(uint64_t);
+            } catch (ObjectDoesntExistException& e) {
+                LOG(WARNING, "User %lu has FOLLOWERS parts but no first part", it->first);
+            }
+        }
+        candidates[it->first] = firstPart + it->second;
+    }
+    for (std::map<uint64_t, uint64_t>::const_iterator it = candidates.begin(); it != candidates.end(); it++)
+        scan->topFollowed.push_back(userWeight(it->second, it->first));
+    std::sort(scan->topFollowed.begin(), scan->topFollowed.end(), std::greater<userWeight>());
+    if (scan->topFollowed.size() > topK)
+        scan->topFollowed.resize(topK);
+}
+
+void
+printTable(const char* name, const tableScan& scan) {
+    string table = name;
+    printf("%-35s:%lu (Key: %luB, Value: %luB, Scan: %0.2fs)\n",
+            (table + " OBJECTS").c_str(), scan.objects, scan.keyBytes,
+            scan.valueBytes, scan.scanTime);
+    for (int c = 0; c < NUM_COLUMNS; c++) {
+        if (scan.columnObjects[c] == 0)
+            continue;
+        printf("%-35s:%lu (Key: %luB, Value: %luB, Avg Value: %0.2fB)\n",
+                (table + " " + columnNames[c]).c_str(), scan.columnObjects[c],
+                scan.columnKeyBytes[c], scan.columnValueBytes[c],
+                (double)scan.columnValueBytes[c] /
+                        (double)scan.columnObjects[c]);
+    }
+    if (scan.partObjects > 0)
+        printf("%-35s:%lu\n", (table + " LIST PARTS").c_str(),
+                scan.partObjects);
+}
+
+void
+printLists(const tableScan& scan) {
+    for (int c = 0; c < NUM_COLUMNS; c++) {
+        const RCDB::LatencyHistogram& h = scan.listHist[c];
+        if (h.getCount() == 0)
+            continue;
+        string column = columnNames[c];
+        printf("%-35s:%0.2f (P50: %lu, P90: %lu, P99: %lu, P99.9: %lu, "
+                "Max: %lu)\n", (column + " LENGTH").c_str(), h.getMean(),
+                h.getPercentile(0.5), h.getPercentile(0.9),
+                h.getPercentile(0.99), h.getPercentile(0.999), h.getMax());
+        for (int b = 0; b < NUM_LENGTH_BUCKETS; b++) {
+            if (scan.listBuckets[c][b] == 0)
+                continue;
+            uint64_t low = (b == 0) ? 0 : 1UL << (b - 1);
+            string range = (b <= 1) ? format("%lu", low) :
+                    format("%lu-%lu", low, (low << 1) - 1);
+            printf("%-35s:%lu (%0.2f%%)\n",
+                    (column + " LENGTH " + range).c_str(),
+                    scan.listBuckets[c][b],
+                    (double)scan.listBuckets[c][b] /
+                            (double)h.getCount() * 100.0);
+        }
+    }
+}
+
+int
+main(int argc, char *argv[])
+try {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    uint64_t topK;
+
+    // Set line buffering for stdout so that printf's and log messages
+    // interleave properly.
+    setvbuf(stdout, NULL, _IOLBF, 1024);
+
+    // need external context to set log levels with OptionParser
+    Context context(false);
+
+    OptionsDescription clientOptions("TwitterDatasetStats");
+    clientOptions.add_options()
+            ("topK",
+            ProgramOptions::value<uint64_t>(&topK)->
+                default_value(10),
+            "Number of users with the most followers to list (default 10).");
+
+    OptionParser optionParser(clientOptions, argc, argv);
+
+    LOG(NOTICE, "TwitterDatasetStats: topK: %lu", topK);
+
+    tableScan userScan;
+    tableScan tweetScan;
+    std::thread userThread(scanTable, std::ref(optionParser), "UserTable", topK, &userScan);
+    std::thread tweetThread(scanTable, std::ref(optionParser), "TweetTable", topK, &tweetScan);
+    userThread.join();
+    tweetThread.join();
+
+    printTable("USERTABLE", userScan);
+    printTable("TWEETTABLE", tweetScan);
+    printLists(userScan);
+
+    // Share of all follow relationships; the sum over all FOLLOWERS
+    // objects counts every part of every list.
+    uint64_t totalFollowers = userScan.listHist[RCDB::ProtoBuf::Key::FOLLOWERS].getSum();
+    for (uint64_t i = 0; i < userScan.topFollowed.size(); i++) {
+        const userWeight& user = userScan.topFollowed[i];
+        printf("%-35s:user %lu, %lu followers (%0.2f%% of all)\n",
+                format("TOP FOLLOWED %lu", i + 1).c_str(), user.second,
+                user.first, totalFollowers > 0 ?
+                        (double)user.first / (double)totalFollowers * 100.0 : 0.0);
+    }
+
+    return 0;
+} catch (RAMCloud::ClientException& e) {
+    fprintf(stderr, "RAMCloud exception: %s\n", e.str().c_str());
+    return 1;
+} catch (RAMCloud::Exception& e) {
+    fprintf(stderr, "RAMCloud exception: %s\n", e.str().c_str());
+    return 1;
+}
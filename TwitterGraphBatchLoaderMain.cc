@@ -17,18 +17,23 @@
 #include <string.h>
 #include <getopt.h>
 #include <assert.h>
+#include <algorithm>
 #include <fstream>
+#include <memory>
+#include <sys/resource.h>
 
 #include "ClusterMetrics.h"
 #include "Cycles.h"
 #include "ShortMacros.h"
 #include "Crc32C.h"
+#include "MultiRead.h"
 #include "ObjectFinder.h"
 #include "OptionParser.h"
 #include "RamCloud.h"
 #include "Tub.h"
 
 #include "RCDB.pb.h"
+#include "TweetTime.h"
 
 using namespace RAMCloud;
 
@@ -37,6 +42,427 @@ using namespace RAMCloud;
  */
 bool fillWithTestData = false;
 
+/*
+ * Checks a finished load against the objects the loader would write. Each
+ * expected object is queued with add(), which keeps only the Crc32C and
+ * length of its value; the actual objects are fetched in multiRead batches
+ * with up to maxOutstanding batches in flight, and compared by checksum.
+ */
+class LoadVerifier {
+  public:
+    LoadVerifier(RamCloud* client, uint32_t batchSize, uint32_t maxOutstanding)
+        : client(client)
+        , batchSize(batchSize)
+        , maxOutstanding(maxOutstanding)
+        , batches(new Batch[maxOutstanding])
+        , current(0)
+        , objectCount(0)
+        , byteCount(0)
+        , missingCount(0)
+        , mismatchCount(0)
+    {
+        for (uint32_t i = 0; i < maxOutstanding; i++) {
+            batches[i].values.reset(new Tub<ObjectBuffer>[batchSize]);
+            batches[i].objects.resize(batchSize);
+            batches[i].requests.resize(batchSize);
+        }
+    }
+
+    /*
+     * Queue one object for checking.
+     *
+     * \param id
+     *      User or tweet ID, only used to describe mismatches.
+     * \param column
+     *      Name of the column, only used to describe mismatches.
+     */
+    void
+    add(uint64_t tableId, const string& key, const void* value, uint32_t length, uint64_t id, const char* column) {
+        Batch& batch = batches[current];
+        if (batch.rpc)
+            check(&batch);
+        batch.entries.push_back(Entry(tableId, key,
+                Crc32C().update(value, length).getResult(), length, id, column));
+        if (batch.entries.size() == batchSize)
+            send();
+    }
+
+    /*
+     * Send any partial batch and check everything still outstanding.
+     */
+    void
+    finish() {
+        if (!batches[current].entries.empty() && !batches[current].rpc)
+            send();
+        for (uint32_t i = 0; i < maxOutstanding; i++)
+            if (batches[i].rpc)
+                check(&batches[i]);
+    }
+
+    uint64_t getObjectCount() const { return objectCount; }
+    uint64_t getByteCount() const { return byteCount; }
+    uint64_t getMissingCount() const { return missingCount; }
+    uint64_t getMismatchCount() const { return mismatchCount; }
+
+  private:
+    struct Entry {
+        Entry(uint64_t tableId, const string& key, uint32_t crc,
+                uint32_t length, uint64_t id, const char* column)
+            : tableId(tableId)
+            , key(key)
+            , crc(crc)
+            , length(length)
+            , id(id)
+            , column(column)
+        {
+        }
+
+        uint64_t tableId;
+        string key;
+        uint32_t crc;
+        uint32_t length;
+        uint64_t id;
+        string column;
+    };
+
+    struct Batch {
+        Batch()
+            : entries()
+            , values()
+            , objects()
+            , requests()
+            , rpc()
+        {
+        }
+
+        std::vector<Entry> entries;
+        std::unique_ptr<Tub<ObjectBuffer>[]> values;
+        std::vector<MultiReadObject> objects;
+        std::vector<MultiReadObject*> requests;
+        Tub<MultiRead> rpc;
+    };
+
+    /// Issue the current batch and move on to the next one.
+    void
+    send() {
+        Batch& batch = batches[current];
+        for (uint32_t i = 0; i < batch.entries.size(); i++) {
+            batch.values[i].destroy();
+            batch.objects[i] = MultiReadObject(batch.entries[i].tableId,
+                    batch.entries[i].key.c_str(), (uint16_t)batch.entries[i].key.length(),
+                    &batch.values[i]);
+            batch.requests[i] = &batch.objects[i];
+        }
+        batch.rpc.construct(client, batch.requests.data(), (uint32_t)batch.entries.size());
+        current = (current + 1) % maxOutstanding;
+    }
+
+    /// Wait for an issued batch and compare what came back.
+    void
+    check(Batch* batch) {
+        batch->rpc->wait();
+        for (uint32_t i = 0; i < batch->entries.size(); i++) {
+            const Entry& entry = batch->entries[i];
+            objectCount++;
+            if (batch->objects[i].status != STATUS_OK || !batch->values[i]) {
+                if (missingCount++ < MAX_REPORTED)
+                    LOG(WARNING, "Verify: %s of %lu is missing", entry.column.c_str(), entry.id);
+                continue;
+            }
+            uint32_t length = 0;
+            const void* value = batch->values[i].get()->getValue(&length);
+            byteCount += length;
+            uint32_t crc = Crc32C().update(value, length).getResult();
+            if (length != entry.length || crc != entry.crc) {
+                if (mismatchCount++ < MAX_REPORTED)
+                    LOG(WARNING, "Verify: %s of %lu differs: expected %u bytes (crc %08x), found %u bytes (crc %08x)", entry.column.c_str(), entry.id, entry.length, entry.crc, length, crc);
+            }
+        }
+        batch->rpc.destroy();
+        batch->entries.clear();
+    }
+
+    /// Missing or mismatched objects beyond this many are only counted.
+    static const uint64_t MAX_REPORTED = 20;
+
+    RamCloud* client;
+    uint32_t batchSize;
+    uint32_t maxOutstanding;
+    std::unique_ptr<Batch[]> batches;
+    // Batch being filled by add().
+    uint32_t current;
+    uint64_t objectCount;
+    uint64_t byteCount;
+    uint64_t missingCount;
+    uint64_t mismatchCount;
+
+    LoadVerifier(const LoadVerifier&);
+    LoadVerifier& operator=(const LoadVerifier&);
+};
+
+/*
+ * Peak resident set size of the loader so far, in MB.
+ */
+double
+peakRssMB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // ru_maxrss is in KB on Linux.
+    return (double)usage.ru_maxrss / 1000.0;
+}
+
+/*
+ * Writes the objects of the dataset or, when verifying, queues them to be
+ * checked instead, and counts what was written.
+ *
+ * ID lists (FOLLOWERS, STREAM, STREAMBUCKET and TWEETS) are produced one ID
+ * at a time with beginList() and append(), so that no list is ever held in
+ * memory whole: IDs go into a buffer of maxListIds entries, allocated once,
+ * which is written out each time it fills. A list of more than maxListIds
+ * IDs would not fit in one object, so it is split as described for
+ * Key.part in RCDB.proto: the key without a part gets the newest maxListIds
+ * IDs, which keeps the tail that transactions read in the object they read,
+ * and parts 1, 2, ... get successively older runs of maxListIds IDs, the
+ * last part whatever is left. Lists that fit are written as one object,
+ * exactly as before.
+ */
+class DatasetWriter {
+  public:
+    DatasetWriter(RamCloud* client, LoadVerifier* verifier, uint32_t maxListIds)
+        : client(client)
+        , verifier(verifier)
+        , maxListIds(maxListIds)
+        , buffer(new uint64_t[maxListIds])
+        , listTableId(0)
+        , listKey()
+        , listRemaining(0)
+        , pieceLength(0)
+        , filled(0)
+        , nextPart(0)
+        , objectCount(0)
+        , keyByteCount(0)
+        , valueByteCount(0)
+        , splitFollowersCount(0)
+        , splitListCount(0)
+        , maxParts(1)
+    {
+    }
+
+    /*
+     * Write one object.
+     *
+     * \param id
+     *      User or tweet ID, only used to describe mismatches when verifying.
+     * \param column
+     *      Name of the column, only used to describe mismatches when
+     *      verifying.
+     */
+    void
+    store(uint64_t tableId, const string& key, const void* value, uint32_t length, uint64_t id, const char* column) {
+        if (verifier != NULL)
+            verifier->add(tableId, key, value, length, id, column);
+        else
+            client->write(tableId, key.c_str(), (uint16_t)key.length(), value, length);
+        objectCount++;
+        keyByteCount += key.length();
+        valueByteCount += length;
+    }
+
+    /*
+     * Start writing an ID list of the given length under key, oldest ID
+     * first. Exactly length calls to append() must follow.
+     */
+    void
+    beginList(uint64_t tableId, const RCDB::ProtoBuf::Key& key, uint64_t length) {
+        assert(listRemaining == 0);
+        listTableId = tableId;
+        listKey = key;
+        listRemaining = length;
+
+        uint64_t parts = (length == 0) ? 1 : (length + maxListIds - 1) / maxListIds;
+        if (parts > 1) {
+            if (key.column() == RCDB::ProtoBuf::Key::FOLLOWERS)
+                splitFollowersCount++;
+            else
+                splitListCount++;
+            maxParts = std::max(maxParts, parts);
+        }
+        // Every part but the oldest is full, so the oldest is written first
+        // with the remainder.
+        nextPart = parts - 1;
+        pieceLength = length - nextPart * maxListIds;
+        if (length == 0)
+            writePiece();
+    }
+
+    void
+    append(uint64_t id) {
+        buffer[filled++] = id;
+        listRemaining--;
+        if (filled == pieceLength)
+            writePiece();
+    }
+
+    /// True between beginList() and the last append() of its list.
+    bool inList() const { return listRemaining > 0; }
+
+    uint64_t getObjectCount() const { return objectCount; }
+    uint64_t getByteCount() const { return keyByteCount + valueByteCount; }
+    /// FOLLOWERS lists that were too long for one object.
+    uint64_t getSplitFollowersCount() const { return splitFollowersCount; }
+    /// STREAM, STREAMBUCKET and TWEETS lists that were too long for one
+    /// object.
+    uint64_t getSplitListCount() const { return splitListCount; }
+    /// Most objects any one list was split into.
+    uint64_t getMaxParts() const { return maxParts; }
+
+  private:
+    void
+    writePiece() {
+        if (nextPart > 0)
+            listKey.set_part((uint32_t)nextPart);
+        else
+            listKey.clear_part();
+        string keyStringBuffer = listKey.SerializeAsString();
+        store(listTableId, keyStringBuffer, buffer.get(), (uint32_t)(filled * sizeof(uint64_t)), listKey.id(), RCDB::ProtoBuf::Key::ColumnType_Name(listKey.column()).c_str());
+        filled = 0;
+        if (nextPart > 0)
+            nextPart--;
+        pieceLength = maxListIds;
+    }
+
+    RamCloud* client;
+    LoadVerifier* verifier;
+    uint32_t maxListIds;
+    std::unique_ptr<uint64_t[]> buffer;
+    // The list being written.
+    uint64_t listTableId;
+    RCDB::ProtoBuf::Key listKey;
+    uint64_t listRemaining;
+    // IDs that go in the part being filled, and how many it has so far.
+    uint64_t pieceLength;
+    uint64_t filled;
+    uint64_t nextPart;
+    uint64_t objectCount;
+    uint64_t keyByteCount;
+    uint64_t valueByteCount;
+    uint64_t splitFollowersCount;
+    uint64_t splitListCount;
+    uint64_t maxParts;
+
+    DatasetWriter(const DatasetWriter&);
+    DatasetWriter& operator=(const DatasetWriter&);
+};
+
+/*
+ * Length of a tweet's text. A function of the tweet ID rather than random so
+ * that a load can be verified.
+ */
+uint64_t
+tweetTextLength(uint64_t tweetId) {
+    return tweetId % 140;
+}
+
+/*
+ * Write a user's stream split into STREAMBUCKET objects, one per
+ * bucketSeconds of tweet time that has any tweets, for time-range queries.
+ * Rather than holding the stream, it is generated twice in tweet ID order:
+ * once to count the IDs in each bucket and once to write them.
+ */
+void
+storeStreamBuckets(DatasetWriter* writer, uint64_t userTableId,
+        uint64_t userId, const std::vector<uint64_t>& followers,
+        uint64_t totalUsers, uint64_t tweetsPerUser, uint64_t bucketSeconds) {
+    std::vector<uint64_t> sortedFollowers(followers);
+    std::sort(sortedFollowers.begin(), sortedFollowers.end());
+
+    // (bucket, number of IDs), in order: IDs ascend, so buckets do too.
+    std::vector<std::pair<uint64_t, uint64_t> > buckets;
+    for (uint64_t tweetNumber = 0; tweetNumber < tweetsPerUser; tweetNumber++) {
+        for (uint64_t friendNumber = 0; friendNumber < sortedFollowers.size(); friendNumber++) {
+            uint64_t bucket = RCDB::streamBucket((totalUsers * tweetNumber) + sortedFollowers[friendNumber], bucketSeconds);
+            if (buckets.empty() || buckets.back().first != bucket)
+                buckets.push_back(std::pair<uint64_t, uint64_t>(bucket, 0));
+            buckets.back().second++;
+        }
+    }
+
+    RCDB::ProtoBuf::Key key;
+    key.set_id(userId);
+    key.set_column(RCDB::ProtoBuf::Key::STREAMBUCKET);
+    uint64_t nextBucket = 0;
+    for (uint64_t tweetNumber = 0; tweetNumber < tweetsPerUser; tweetNumber++) {
+        for (uint64_t friendNumber = 0; friendNumber < sortedFollowers.size(); friendNumber++) {
+            if (!writer->inList()) {
+                key.set_bucket(buckets[nextBucket].first);
+                writer->beginList(userTableId, key, buckets[nextBucket].second);
+                nextBucket++;
+            }
+            writer->append((totalUsers * tweetNumber) + sortedFollowers[friendNumber]);
+        }
+    }
+}
+
+/*
+ * Write everything for one user: USERID:FOLLOWERS, USERID:STREAM (and its
+ * STREAMBUCKETs), TWEETID:DATA for each of the user's tweets and
+ * USERID:TWEETS. The stream and tweet lists are generated as they are
+ * written.
+ */
+void
+storeUser(DatasetWriter* writer, uint64_t userTableId, uint64_t tweetTableId,
+        uint64_t userId, const std::vector<uint64_t>& followers,
+        uint64_t totalUsers, uint64_t tweetsPerUser,
+        uint64_t streamBucketSeconds, const string& tweetString) {
+    RCDB::ProtoBuf::Key key;
+
+    // Write USERID:FOLLOWERS for this user.
+    key.set_id(userId);
+    key.set_column(RCDB::ProtoBuf::Key::FOLLOWERS);
+    writer->beginList(userTableId, key, followers.size());
+    for (uint64_t i = 0; i < followers.size(); i++)
+        writer->append(followers[i]);
+
+    // Write USERID:STREAM for this user.
+    key.set_column(RCDB::ProtoBuf::Key::STREAM);
+    writer->beginList(userTableId, key, tweetsPerUser * followers.size());
+    for (uint64_t tweetNumber = 0; tweetNumber < tweetsPerUser; tweetNumber++)
+        for (uint64_t friendNumber = 0; friendNumber < followers.size(); friendNumber++)
+            writer->append((totalUsers * tweetNumber) + followers[friendNumber]);
+
+    if (streamBucketSeconds > 0)
+        storeStreamBuckets(writer, userTableId, userId, followers, totalUsers, tweetsPerUser, streamBucketSeconds);
+
+    key.Clear();
+
+    // Write TWEETID:DATA for each tweet from this user.
+    RCDB::ProtoBuf::Tweet tweetData;
+    for (uint64_t i = 0; i < tweetsPerUser; i++) {
+        uint64_t tweetId = (totalUsers * i) + userId;
+        key.set_id(tweetId);
+        key.set_column(RCDB::ProtoBuf::Key::DATA);
+        tweetData.set_text(tweetString.substr(0, tweetTextLength(tweetId)));
+        tweetData.set_time(RCDB::tweetTime(tweetId));
+        tweetData.set_user(userId);
+
+        string keyStringBuffer = key.SerializeAsString();
+        string valueStringBuffer = tweetData.SerializeAsString();
+
+        writer->store(tweetTableId, keyStringBuffer,
+                valueStringBuffer.c_str(), (uint32_t) valueStringBuffer.length(), tweetId, "DATA");
+
+        key.Clear();
+        tweetData.Clear();
+    }
+
+    // Write USERID:TWEETS for this user.
+    key.set_id(userId);
+    key.set_column(RCDB::ProtoBuf::Key::TWEETS);
+    writer->beginList(userTableId, key, tweetsPerUser);
+    for (uint64_t i = 0; i < tweetsPerUser; i++)
+        writer->append((totalUsers * i) + userId);
+}
+
 int
 main(int argc, char *argv[])
 try {
@@ -49,10 +475,12 @@ try {
     uint64_t tweetsPerUser;
     string edgeListFileName;
 
-    uint64_t STARTING_TWEET_TIME = 1230800000;
-    uint64_t TWEETS_PER_SECOND = 1000;
-    
-    uint32_t SERVER_SPAN = 3;
+    uint32_t serverSpan;
+    uint64_t streamBucketSeconds;
+    uint32_t maxListBytes;
+    bool verify;
+    uint32_t verifyBatchSize;
+    uint32_t verifyOutstanding;
 
     // Set line buffering for stdout so that printf's and log messages
     // interleave properly.
@@ -83,11 +511,41 @@ try {
             "Number of tweets to seed each user with.")
             ("edgeList",
             ProgramOptions::value<string>(&edgeListFileName),
-            "Edgelist file to load into RAMCloud");
+            "Edgelist file to load into RAMCloud")
+            ("serverSpan",
+            ProgramOptions::value<uint32_t>(&serverSpan)->
+            default_value(3),
+            "Number of masters to split each table across (default 3).")
+            ("streamBucketSeconds",
+            ProgramOptions::value<uint64_t>(&streamBucketSeconds)->
+            default_value(0),
+            "Also index each user's stream in buckets of this many seconds of tweet time, for the streamsince transaction (0 for none; default 0).")
+            ("maxListBytes",
+            ProgramOptions::value<uint32_t>(&maxListBytes)->
+            default_value(1000000),
+            "Largest value to write for one FOLLOWERS, STREAM, STREAMBUCKET or TWEETS list; longer lists are split into parts (default 1000000, under RAMCloud's 1MB object limit).")
+            ("verify",
+            ProgramOptions::value<bool>(&verify)->
+            default_value(false),
+            "Instead of loading, check that the tables hold exactly what loading this edge list would write (default false).")
+            ("verifyBatchSize",
+            ProgramOptions::value<uint32_t>(&verifyBatchSize)->
+            default_value(1000),
+            "Objects per multiRead when verifying (default 1000).")
+            ("verifyOutstanding",
+            ProgramOptions::value<uint32_t>(&verifyOutstanding)->
+            default_value(4),
+            "Number of multiReads in flight when verifying (default 4).");
 
     OptionParser optionParser(clientOptions, argc, argv);
 
-    LOG(NOTICE, "TwitterGraphBatchLoader: totalUsers: %lu, tweetsPerUser: %lu, edgeList: %s", totalUsers, tweetsPerUser, edgeListFileName.c_str());
+    LOG(NOTICE, "TwitterGraphBatchLoader: totalUsers: %lu, tweetsPerUser: %lu, edgeList: %s, serverSpan: %u, streamBucketSeconds: %lu, maxListBytes: %u, verify: %d, verifyBatchSize: %u, verifyOutstanding: %u", totalUsers, tweetsPerUser, edgeListFileName.c_str(), serverSpan, streamBucketSeconds, maxListBytes, verify, verifyBatchSize, verifyOutstanding);
+
+    if (verify && (verifyBatchSize == 0 || verifyOutstanding == 0))
+        DIE("verifyBatchSize and verifyOutstanding must be at least 1");
+
+    if (maxListBytes < sizeof(uint64_t))
+        DIE("maxListBytes must hold at least one ID");
     
     context.transportManager->setSessionTimeout(
             optionParser.options.getSessionTimeout());
@@ -100,9 +558,18 @@ try {
             optionParser.options.getCoordinatorLocator().c_str(),
             optionParser.options.getClusterName().c_str());
 
-    uint64_t userTableId = client.createTable("UserTable", SERVER_SPAN);
-    uint64_t tweetTableId = client.createTable("TweetTable", SERVER_SPAN);
-    uint64_t idTableId = client.createTable("IDTable", SERVER_SPAN);
+    uint64_t userTableId, tweetTableId, idTableId;
+    Tub<LoadVerifier> verifier;
+    if (verify) {
+        userTableId = client.getTableId("UserTable");
+        tweetTableId = client.getTableId("TweetTable");
+        idTableId = client.getTableId("IDTable");
+        verifier.construct(&client, verifyBatchSize, verifyOutstanding);
+    } else {
+        userTableId = client.createTable("UserTable", serverSpan);
+        tweetTableId = client.createTable("TweetTable", serverSpan);
+        idTableId = client.createTable("IDTable", serverSpan);
+    }
 
     LOG(NOTICE, "created/found userTable (id %lu), tweetTable (id %lu), and IDTable (id %lu)\n", userTableId, tweetTableId, idTableId);
 
@@ -112,15 +579,10 @@ try {
 
     int64_t srcID, dstID;
     int64_t curSrcID = -1;
+    // Reused for every user, so it only grows to the largest follower count.
     std::vector<uint64_t> userFollowers;
-    std::vector<uint64_t> userStream;
-    std::vector<uint64_t> userTweets;
-    RCDB::ProtoBuf::Tweet tweetData;
-    RCDB::ProtoBuf::Key key;
+    DatasetWriter writer(&client, verifier.get(), maxListBytes / (uint32_t)sizeof(uint64_t));
     uint64_t lineCount = 0;
-    uint64_t writeCount = 0;
-    uint64_t keyByteCount = 0;
-    uint64_t valueByteCount = 0;
     uint64_t start_time = Cycles::rdtsc();
     while (edgeListFileStream >> srcID >> dstID) {
         if (curSrcID == -1)
@@ -130,95 +592,10 @@ try {
             //LOG(NOTICE, "Adding Follower %lu", dstID);
             userFollowers.push_back(dstID);
         } else {
-            // Write USERID:FOLLOWERS for this user.
-            key.set_id(curSrcID);
-            key.set_column(RCDB::ProtoBuf::Key::FOLLOWERS);
-
-            string keyStringBuffer = key.SerializeAsString();
-
-            //LOG(NOTICE, "Writing USERID:FOLLOWERS with size %d", (int) (keyStringBuffer.length() + valueStringBuffer.length()));
-            client.write(userTableId,
-                    keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
-                    (const void*)userFollowers.data(), (uint32_t)userFollowers.size()*(uint32_t)sizeof(uint64_t));
+            storeUser(&writer, userTableId, tweetTableId, curSrcID, userFollowers, totalUsers, tweetsPerUser, streamBucketSeconds, tweetString);
 
-            writeCount++;
-
-            keyByteCount += keyStringBuffer.length();
-            valueByteCount += userFollowers.size()*sizeof(uint64_t);
-
-            key.Clear();
-
-            // Write USERID:STREAM for this user.
-            key.set_id(curSrcID);
-            key.set_column(RCDB::ProtoBuf::Key::STREAM);
-
-            for (uint64_t tweetNumber = 0; tweetNumber < tweetsPerUser; tweetNumber++)
-                for (uint64_t friendNumber = 0; friendNumber < (uint64_t) userFollowers.size(); friendNumber++)
-                    userStream.push_back((totalUsers * tweetNumber) + userFollowers[friendNumber]);
-
-            keyStringBuffer = key.SerializeAsString();
-
-            //LOG(NOTICE, "Writing USERID:STREAM with size %d", (int) (keyStringBuffer.length() + valueStringBuffer.length()));
-            client.write(userTableId,
-                    keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
-                    (const void*)userStream.data(), (uint32_t)userStream.size()*(uint32_t)sizeof(uint64_t));
-
-            writeCount++;
-
-            keyByteCount += keyStringBuffer.length();
-            valueByteCount += userStream.size()*sizeof(uint64_t);
-
-            key.Clear();
-            userStream.clear();
             userFollowers.clear();
 
-            // Write TWEETID:DATA for each tweet from this user.
-            for (uint64_t i = 0; i < tweetsPerUser; i++) {
-                key.set_id((totalUsers * i) + curSrcID);
-                key.set_column(RCDB::ProtoBuf::Key::DATA);
-                tweetData.set_text(tweetString.substr(0, rand() % 140));
-                tweetData.set_time(STARTING_TWEET_TIME + ((totalUsers * i) + curSrcID) / TWEETS_PER_SECOND);
-                tweetData.set_user(curSrcID);
-
-                string keyStringBuffer = key.SerializeAsString();
-                string valueStringBuffer = tweetData.SerializeAsString();
-
-                //LOG(NOTICE, "Writing TWEET:DATA with size %d", (int) (keyStringBuffer.length() + valueStringBuffer.length()));
-                client.write(tweetTableId,
-                        keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
-                        valueStringBuffer.c_str(), (uint32_t) valueStringBuffer.length());
-
-                writeCount++;
-
-                keyByteCount += keyStringBuffer.length();
-                valueByteCount += valueStringBuffer.length();
-
-                key.Clear();
-                tweetData.Clear();
-            }
-
-            // Write USERID:TWEETS for this user.
-            key.set_id(curSrcID);
-            key.set_column(RCDB::ProtoBuf::Key::TWEETS);
-
-            for (uint64_t i = 0; i < tweetsPerUser; i++)
-                userTweets.push_back((totalUsers * i) + curSrcID);
-
-            keyStringBuffer = key.SerializeAsString();
-
-            //LOG(NOTICE, "Writing USERID:TWEETS with size %d", (int) (keyStringBuffer.length() + valueStringBuffer.length()));
-            client.write(userTableId,
-                    keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
-                    (const void*)userTweets.data(), (uint32_t)userTweets.size()*(uint32_t)sizeof(uint64_t));
-            
-            writeCount++;
-
-            keyByteCount += keyStringBuffer.length();
-            valueByteCount += userTweets.size()*sizeof(uint64_t);
-
-            key.Clear();
-            userTweets.clear();
-
             curSrcID = srcID;
 
             userFollowers.push_back(dstID);
@@ -227,106 +604,18 @@ try {
         lineCount++;
 
         if (lineCount % 100000 == 0)
-            LOG(NOTICE, "processed %lu edges (%0.2f MB to RamCloud) in %0.2f seconds, avg. %0.2f MB/s", lineCount, (float) (keyByteCount + valueByteCount) / 1000000.0, (float) Cycles::toSeconds(Cycles::rdtsc() - start_time), ((float) (keyByteCount + valueByteCount) / (float) Cycles::toSeconds(Cycles::rdtsc() - start_time)) / 1000000.0);
+            LOG(NOTICE, "processed %lu edges (%0.2f MB to RamCloud) in %0.2f seconds, avg. %0.2f MB/s, peak RSS %0.2f MB", lineCount, (float) writer.getByteCount() / 1000000.0, (float) Cycles::toSeconds(Cycles::rdtsc() - start_time), ((float) writer.getByteCount() / (float) Cycles::toSeconds(Cycles::rdtsc() - start_time)) / 1000000.0, peakRssMB());
     }
 
-    // Write USERID:FOLLOWERS for this user.
-    key.set_id(curSrcID);
-    key.set_column(RCDB::ProtoBuf::Key::FOLLOWERS);
-
-    string keyStringBuffer = key.SerializeAsString();
-
-    //LOG(NOTICE, "Writing USERID:FOLLOWERS with size %d", (int) (keyStringBuffer.length() + valueStringBuffer.length()));
-    client.write(userTableId,
-            keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
-            (const void*)userFollowers.data(), (uint32_t)userFollowers.size()*(uint32_t)sizeof(uint64_t));
-
-    writeCount++;
-
-    keyByteCount += keyStringBuffer.length();
-    valueByteCount += userFollowers.size()*sizeof(uint64_t);
-
-    key.Clear();
-
-    // Write USERID:STREAM for this user.
-    key.set_id(curSrcID);
-    key.set_column(RCDB::ProtoBuf::Key::STREAM);
-
-    for (uint64_t tweetNumber = 0; tweetNumber < tweetsPerUser; tweetNumber++)
-        for (uint64_t friendNumber = 0; friendNumber < (uint64_t) userFollowers.size(); friendNumber++)
-            userStream.push_back((totalUsers * tweetNumber) + userFollowers[friendNumber]);
-
-    keyStringBuffer = key.SerializeAsString();
-
-    //LOG(NOTICE, "Writing USERID:STREAM with size %d", (int) (keyStringBuffer.length() + valueStringBuffer.length()));
-    client.write(userTableId,
-            keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
-            (const void*)userStream.data(), (uint32_t)userStream.size()*(uint32_t)sizeof(uint64_t));
-
-    writeCount++;
-
-    keyByteCount += keyStringBuffer.length();
-    valueByteCount += userStream.size()*sizeof(uint64_t);
-
-    key.Clear();
-    userStream.clear();
-    userFollowers.clear();
-
-    // Write TWEETID:DATA for each tweet from this user.
-    for (uint64_t i = 0; i < tweetsPerUser; i++) {
-        key.set_id((totalUsers * i) + curSrcID);
-        key.set_column(RCDB::ProtoBuf::Key::DATA);
-        tweetData.set_text(tweetString.substr(0, rand() % 140));
-        tweetData.set_time(STARTING_TWEET_TIME + ((totalUsers * i) + curSrcID) / TWEETS_PER_SECOND);
-        tweetData.set_user(curSrcID);
-
-        string keyStringBuffer = key.SerializeAsString();
-        string valueStringBuffer = tweetData.SerializeAsString();
-
-        //LOG(NOTICE, "Writing TWEET:DATA with size %d", (int) (keyStringBuffer.length() + valueStringBuffer.length()));
-        client.write(tweetTableId,
-                keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
-                valueStringBuffer.c_str(), (uint32_t) valueStringBuffer.length());
-
-        writeCount++;
-
-        keyByteCount += keyStringBuffer.length();
-        valueByteCount += valueStringBuffer.length();
-
-        key.Clear();
-        tweetData.Clear();
-    }
-
-    // Write USERID:TWEETS for this user.
-    key.set_id(curSrcID);
-    key.set_column(RCDB::ProtoBuf::Key::TWEETS);
-
-    for (uint64_t i = 0; i < tweetsPerUser; i++)
-        userTweets.push_back((totalUsers * i) + curSrcID);
-
-    keyStringBuffer = key.SerializeAsString();
-
-    //LOG(NOTICE, "Writing USERID:TWEETS with size %d", (int) (keyStringBuffer.length() + valueStringBuffer.length()));
-    client.write(userTableId,
-            keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
-            (const void*)userTweets.data(), (uint32_t)userTweets.size()*(uint32_t)sizeof(uint64_t));
-
-    writeCount++;
-
-    keyByteCount += keyStringBuffer.length();
-    valueByteCount += userTweets.size()*sizeof(uint64_t);
-
-    key.Clear();
-    userTweets.clear();
+    storeUser(&writer, userTableId, tweetTableId, curSrcID, userFollowers, totalUsers, tweetsPerUser, streamBucketSeconds, tweetString);
 
     // Finally create userID and tweetID generators in idTable.
     RCDB::ProtoBuf::IDTableKey idTableKey;
     idTableKey.set_type(RCDB::ProtoBuf::IDTableKey::USERID);
-    keyStringBuffer = idTableKey.SerializeAsString();
+    string keyStringBuffer = idTableKey.SerializeAsString();
     
-    client.write(idTableId, 
-            keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
-            (const void*)&curSrcID, sizeof(uint64_t));
+    writer.store(idTableId, keyStringBuffer,
+            (const void*)&curSrcID, sizeof(uint64_t), 0, "USERID");
     
     //printf("nextUserID: %lu\n", client.increment(idTableId, keyStringBuffer.c_str(), (uint16_t)keyStringBuffer.length(), 1));
     
@@ -334,12 +623,47 @@ try {
     keyStringBuffer = idTableKey.SerializeAsString();
     uint64_t curMaxTweetID = (totalUsers * (tweetsPerUser-1)) + curSrcID;
     
-    client.write(idTableId,
-            keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
-            (const void*)&curMaxTweetID, sizeof(uint64_t));
+    writer.store(idTableId, keyStringBuffer,
+            (const void*)&curMaxTweetID, sizeof(uint64_t), 0, "TWEETID");
     
     //printf("nextTweetID: %lu\n", client.increment(idTableId, keyStringBuffer.c_str(), (uint16_t)keyStringBuffer.length(), 1));
     
+    if (streamBucketSeconds > 0) {
+        idTableKey.set_type(RCDB::ProtoBuf::IDTableKey::STREAMBUCKETSECONDS);
+        keyStringBuffer = idTableKey.SerializeAsString();
+        writer.store(idTableId, keyStringBuffer,
+                (const void*)&streamBucketSeconds, sizeof(uint64_t), 0, "STREAMBUCKETSECONDS");
+    }
+    
+    // Reset the workload clients' start barrier counter. Its value depends
+    // on the runs since the load, so it is not verified.
+    if (!verify) {
+        idTableKey.set_type(RCDB::ProtoBuf::IDTableKey::BARRIER);
+        keyStringBuffer = idTableKey.SerializeAsString();
+        uint64_t barrierCount = 0;
+        
+        client.write(idTableId,
+                keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
+                (const void*)&barrierCount, sizeof(uint64_t));
+    }
+    
+    if (verify) {
+        verifier->finish();
+        double seconds = Cycles::toSeconds(Cycles::rdtsc() - start_time);
+        LOG(NOTICE, "verified %lu objects (%0.2f MB) in %0.2f seconds, avg. %0.0f objects/s, %0.2f MB/s: %lu missing, %lu mismatched, peak RSS %0.2f MB", verifier->getObjectCount(), (double)verifier->getByteCount() / 1000000.0, seconds, (double)verifier->getObjectCount() / seconds, (double)verifier->getByteCount() / seconds / 1000000.0, verifier->getMissingCount(), verifier->getMismatchCount(), peakRssMB());
+        if (verifier->getMissingCount() > 0 || verifier->getMismatchCount() > 0)
+            return 1;
+    } else {
+        LOG(NOTICE, "loaded %lu objects (%0.2f MB) in %0.2f seconds, lists split into parts: %lu FOLLOWERS, %lu STREAM/STREAMBUCKET/TWEETS (at most %lu parts), peak RSS %0.2f MB", writer.getObjectCount(), (double)writer.getByteCount() / 1000000.0, Cycles::toSeconds(Cycles::rdtsc() - start_time), writer.getSplitFollowersCount(), writer.getSplitListCount(), writer.getMaxParts(), peakRssMB());
+    }
+
+    // The workload client reads and rewrites only the key without a part,
+    // so results on such a dataset do not reflect the whole lists.
+    if (writer.getSplitFollowersCount() > 0)
+        LOG(WARNING, "%lu users have FOLLOWERS lists larger than maxListBytes; tweet fan-out in TwitterWorkloadClient only reaches the followers in the newest part", writer.getSplitFollowersCount());
+    if (writer.getSplitListCount() > 0)
+        LOG(WARNING, "%lu STREAM, STREAMBUCKET or TWEETS lists are larger than maxListBytes; follow, unfollow and streamsince in TwitterWorkloadClient only see the newest part", writer.getSplitListCount());
+    
     // Check out user.
 //    uint64_t readUserID = 99999;
 //    key.set_id(readUserID);
@@ -0,0 +1,140 @@
+/* Copyright (c) 2009-2014 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Offline converter from the binary .blat latency logs written by
+ * TwitterWorkloadClient to the text .lat format. Runs anywhere; it does not
+ * need RAMCloud.
+ *
+ *   TwitterLatLogConvert [--stages] <input.blat> [<output.lat>]
+ *
+ * With --stages, each line additionally carries the transaction start time
+ * (seconds since the epoch) and the latency and multi-op size of every stage.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "LatencyLog.h"
+
+using std::string;
+
+static void
+usage(const char* argv0)
+{
+    fprintf(stderr, "usage: %s [--stages] <input.blat> [<output.lat>]\n",
+            argv0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    bool printStages = false;
+    int argi = 1;
+    if (argi < argc && strcmp(argv[argi], "--stages") == 0) {
+        printStages = true;
+        argi++;
+    }
+    if (argi >= argc || argc - argi > 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    string inFileName = argv[argi];
+    string outFileName;
+    if (argc - argi == 2) {
+        outFileName = argv[argi + 1];
+    } else {
+        outFileName = inFileName;
+        size_t dot = outFileName.rfind(".blat");
+        if (dot != string::npos)
+            outFileName.erase(dot);
+        outFileName += ".lat";
+    }
+
+    FILE* in = fopen(inFileName.c_str(), "r");
+    if (in == NULL) {
+        fprintf(stderr, "Could not open %s\n", inFileName.c_str());
+        return 1;
+    }
+
+    RCDB::LatencyLogHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+            memcmp(header.magic, LATLOG_MAGIC, strlen(LATLOG_MAGIC)) != 0) {
+        fprintf(stderr, "%s is not a latency log\n", inFileName.c_str());
+        return 1;
+    }
+    if (header.version != LATLOG_VERSION ||
+            header.recordSize != sizeof(RCDB::LatencyLogRecord)) {
+        fprintf(stderr, "%s has unsupported version %u (record size %u)\n",
+                inFileName.c_str(), header.version, header.recordSize);
+        return 1;
+    }
+
+    FILE* out = fopen(outFileName.c_str(), "w");
+    if (out == NULL) {
+        fprintf(stderr, "Could not open %s\n", outFileName.c_str());
+        return 1;
+    }
+
+    double usPerCycle = 1e6 / header.cyclesPerSec;
+
+    if (printStages) {
+        fprintf(out, "%12s%12s%12s%20s", "#USERID", "TXTYPE", "LATENCY(us)",
+                "TIME(s)");
+        for (int i = 0; i < LATLOG_NUM_STAGES; i++) {
+            char name[16];
+            snprintf(name, sizeof(name), "OP%d(us)", i);
+            fprintf(out, "%12s", name);
+            snprintf(name, sizeof(name), "OP%dSIZE", i);
+            fprintf(out, "%12s", name);
+        }
+        fprintf(out, "\n");
+    } else {
+        fprintf(out, LATFILE_HDRFMTSTR, "#USERID", "TXTYPE", "LATENCY(us)");
+    }
+
+    RCDB::LatencyLogRecord record;
+    uint64_t count = 0;
+    while (fread(&record, sizeof(record), 1, in) == 1) {
+        const char* txType = record.txType < RCDB::LATLOG_NUM_TX_TYPES ?
+                RCDB::latLogTxTypeNames[record.txType] : "??";
+        if (!printStages) {
+            fprintf(out, LATFILE_ENTFMTSTR, record.userId, txType,
+                    (double)record.latency * usPerCycle);
+        } else {
+            double time = (double)header.startWallTimeNs / 1e9 +
+                    ((double)record.timestamp - (double)header.startCycles) /
+                    header.cyclesPerSec;
+            fprintf(out, "%12lu%12s%12.2f%20.6f", record.userId, txType,
+                    (double)record.latency * usPerCycle, time);
+            for (int i = 0; i < LATLOG_NUM_STAGES; i++)
+                fprintf(out, "%12.2f%12u",
+                        (double)record.stageLatency[i] * usPerCycle,
+                        record.multiOpSize[i]);
+            fprintf(out, "\n");
+        }
+        count++;
+    }
+
+    fclose(out);
+    fclose(in);
+
+    printf("Converted %lu records from s%02lu_t%02lu (%s) to %s\n", count,
+            header.serverNumber, header.threadNumber, inFileName.c_str(),
+            outFileName.c_str());
+    return 0;
+}
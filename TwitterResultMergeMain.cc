@@ -0,0 +1,181 @@
+/* Copyright (c) 2009-2014 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Combines the per-client sNN.sum files of a multi-machine run into one
+ * cluster-wide summary. Throughputs are added up and percentiles are read
+ * from the merged latency histograms. Does not need RAMCloud.
+ *
+ *   TwitterResultMerge [-o <merged.sum>] [-t <merged.ts>] <s00.sum> ...
+ *
+ * The summary is printed to stdout; -o additionally writes the merged .sum,
+ * which can itself be merged again, and -t the cluster-wide time series of
+ * the --reportInterval intervals, merged from their histograms.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "RunSummary.h"
+
+using std::string;
+
+static void
+usage(const char* argv0)
+{
+    fprintf(stderr, "usage: %s [-o <merged.sum>] [-t <merged.ts>] "
+            "<file.sum> ...\n", argv0);
+}
+
+static double
+average(uint64_t total, uint64_t count)
+{
+    return count == 0 ? 0.0 : (double)total / (double)count;
+}
+
+int
+main(int argc, char *argv[])
+{
+    string outFileName, tsFileName;
+    int argi = 1;
+    while (argi + 1 < argc && argv[argi][0] == '-') {
+        if (strcmp(argv[argi], "-o") == 0) {
+            outFileName = argv[argi + 1];
+        } else if (strcmp(argv[argi], "-t") == 0) {
+            tsFileName = argv[argi + 1];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+        argi += 2;
+    }
+    if (argi >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    RCDB::RunSummary cluster;
+    for (; argi < argc; argi++) {
+        RCDB::RunSummary client;
+        string error;
+        if (!client.read(argv[argi], &error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        cluster.merge(client);
+    }
+
+    printf("%-35s:%lu\n", "CLIENTS", cluster.numClients);
+    printf("%-35s:%lu\n", "THREADS", cluster.numThreads);
+    printf("%-35s:%0.2fs\n", "RUNTIME", cluster.measureTime);
+    printf("%-35s:%0.2fs\n", "TOTAL RUNTIME", cluster.totalTime);
+    printf("%-35s:%0.6f (Skew: %0.3fms)\n", "START TIME",
+            cluster.firstStartTime,
+            (cluster.lastStartTime - cluster.firstStartTime) * 1000.0);
+    printf("%-35s:%0.1f%% (Max: %0.1f%%, Dispatch Threads: %lu)\n",
+            "CLIENT BUSY", cluster.numThreads > 0 ? cluster.clientBusy /
+                    (double)cluster.numThreads * 100.0 : 0.0,
+            cluster.maxClientBusy * 100.0, cluster.dispatchThreads);
+
+    double totalThroughput = 0.0;
+    for (size_t i = 0; i < cluster.txs.size(); i++)
+        totalThroughput += cluster.txs[i].throughput;
+    printf("%-35s:%0.2ftx/s\n", "TOTAL THROUGHPUT", totalThroughput);
+
+    for (size_t i = 0; i < cluster.txs.size(); i++) {
+        const RCDB::RunSummaryTx& tx = cluster.txs[i];
+        const RCDB::LatencyHistogram& h = tx.hist;
+        string name = tx.name;
+        printf("%-35s:%lu\n", (name + " TRANSACTIONS").c_str(), tx.count);
+        printf("%-35s:%0.2ftx/s\n", (name + " TX THROUGHPUT").c_str(),
+                tx.throughput);
+        printf("%-35s:%0.2fus\n", ("AVERAGE " + name + " TX TIME").c_str(),
+                average(tx.totalNs, tx.count) / 1000.0);
+        printf("%-35s:%0.2fus (P90: %0.2fus, P99: %0.2fus, "
+                "P99.9: %0.2fus, Max: %0.2fus)\n",
+                (name + " TX TIME PERCENTILES").c_str(),
+                (double)h.getPercentile(0.5) / 1000.0,
+                (double)h.getPercentile(0.9) / 1000.0,
+                (double)h.getPercentile(0.99) / 1000.0,
+                (double)h.getPercentile(0.999) / 1000.0,
+                (double)h.getMax() / 1000.0);
+
+        for (size_t j = 0; j < cluster.ops.size(); j++) {
+            const RCDB::RunSummaryOp& op = cluster.ops[j];
+            if (op.txName != tx.name)
+                continue;
+            // Reported like the .dat files, as the op's flags say.
+            uint64_t perObject = (op.flags & OP_MULTI) ?
+                    op.multiOpSize : op.opCount;
+            string label = "AVERAGE " + op.name;
+            for (size_t k = 0; k < label.size(); k++)
+                if (label[k] == '_')
+                    label[k] = ' ';
+            printf("%-35s:%0.2fus", label.c_str(),
+                    average(op.totalNs, op.opCount) / 1000.0);
+            if (!(op.flags & OP_NOBYTES)) {
+                printf(" (Key: %0.2fB, Value: %0.2fB",
+                        average(op.keyBytes, perObject),
+                        average(op.valueBytes, perObject));
+                if (op.flags & OP_MULTI)
+                    printf(", MOpSize: %0.2f",
+                            average(op.multiOpSize, op.opCount));
+                if (op.flags & OP_REJECTS)
+                    printf(", RejectCount: %lu", op.rejectCount);
+                printf(")");
+            }
+            printf("\n");
+        }
+    }
+
+    if (!cluster.masters.empty()) {
+        // Skew is the busiest master's share of ops relative to an even split.
+        uint64_t totalOps = 0, maxOps = 0;
+        for (size_t i = 0; i < cluster.masters.size(); i++) {
+            totalOps += cluster.masters[i].opCount;
+            maxOps = std::max(maxOps, cluster.masters[i].opCount);
+        }
+        double meanOps = (double)totalOps / (double)cluster.masters.size();
+        printf("%-35s:%lu (Max/Mean Ops: %0.2f)\n", "MASTERS",
+                cluster.masters.size(),
+                meanOps > 0.0 ? (double)maxOps / meanOps : 0.0);
+        for (size_t i = 0; i < cluster.masters.size(); i++) {
+            const RCDB::RunSummaryMaster& m = cluster.masters[i];
+            printf("%-35s:%lu ops (%0.1f%%), Key: %luB, Value: %luB, "
+                    "RPCs: %lu, Avg: %0.2fus, P50: %0.2fus, P99: %0.2fus, "
+                    "P99.9: %0.2fus, Max: %0.2fus\n",
+                    ("MASTER " + m.locator).c_str(), m.opCount,
+                    totalOps > 0 ?
+                            (double)m.opCount / (double)totalOps * 100.0 : 0.0,
+                    m.keyBytes, m.valueBytes, m.rpcCount,
+                    average(m.rpcNs, m.rpcCount) / 1000.0,
+                    (double)m.rpcHist.getPercentile(0.5) / 1000.0,
+                    (double)m.rpcHist.getPercentile(0.99) / 1000.0,
+                    (double)m.rpcHist.getPercentile(0.999) / 1000.0,
+                    (double)m.rpcHist.getMax() / 1000.0);
+        }
+    }
+
+    if (!outFileName.empty() && !cluster.write(outFileName)) {
+        fprintf(stderr, "Could not write %s\n", outFileName.c_str());
+        return 1;
+    }
+    if (!tsFileName.empty() && !cluster.writeTimeSeries(tsFileName)) {
+        fprintf(stderr, "Could not write %s\n", tsFileName.c_str());
+        return 1;
+    }
+    return 0;
+}
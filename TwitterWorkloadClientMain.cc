@@ -16,8 +16,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
 #include <assert.h>
+#include <algorithm>
 #include <fstream>
+#include <map>
+#include <sstream>
 #include <thread>
 #include <random>
 
@@ -25,23 +30,34 @@
 #include "Cycles.h"
 #include "ShortMacros.h"
 #include "Crc32C.h"
+#include "MultiRead.h"
+#include "MultiWrite.h"
 #include "ObjectFinder.h"
 #include "OptionParser.h"
 #include "RamCloud.h"
 #include "Tub.h"
 
 #include "RCDB.pb.h"
+#include "LatencyHistogram.h"
+#include "LatencyLog.h"
+#include "RunSummary.h"
+#include "TweetTime.h"
+#include "TxTrace.h"
 
 using namespace RAMCloud;
 
-// USERID, TXTYPE, LATENCY
-#define LATFILE_HDRFMTSTR "%12s%12s%12s\n"
-#define LATFILE_ENTFMTSTR "%12lu%12s%12.2f\n"
-
 // RUNTIME, STREAM_UPDATE_FAILURES
 #define DATFILE_HDRFMTSTR "%12s\n"
 #define DATFILE_ENTFMTSTR "%12.2f\n"
 
+// THREADS, TPUT, SLO TX TPUT, SLO TX AVG, P50, P99, P999, MAX (all clients)
+#define SWEEPFILE_HDRFMTSTR "%10s%14s%14s%12s%12s%12s%12s%12s\n"
+#define SWEEPFILE_ENTFMTSTR "%10lu%14.2f%14.2f%12.2f%12.2f%12.2f%12.2f%12.2f\n"
+
+// Most STREAMBUCKETs a streamsince reads in one multiRead. It reads batches
+// newest first and stops once its page is full.
+#define STREAMSINCE_BUCKET_BATCH 16
+
 #define NUM_STATS 10
 
 typedef struct {
@@ -62,28 +78,1669 @@ uint64_t timePassed(opStat x) {
     return x.endTime - x.startTime;
 }
 
+void mergeOpStat(opStat* into, const opStat& from) {
+    into->totalTime += from.totalTime;
+    into->totalKeyBytes += from.totalKeyBytes;
+    into->totalValueBytes += from.totalValueBytes;
+    into->totalMultiOpSize += from.totalMultiOpSize;
+    into->opCount += from.opCount;
+    into->rejectCount += from.rejectCount;
+}
+
+/*
+ * Transaction types. The order matches RCDB::LatencyLogTxType, so that the
+ * latency log records each type under the same number.
+ */
+enum txType {
+    TX_STREAM,
+    TX_TWEET,
+    TX_TIMELINE,
+    TX_FOLLOW,
+    TX_UNFOLLOW,
+    TX_STREAMPAGE,
+    TX_READTWEET,
+    TX_STREAMSINCE,
+    NUM_TX_TYPES
+};
+
+typedef struct {
+  // Name as it appears in .sum files.
+  const char* name;
+  // How the stage's statistics are reported (OP_* in RunSummary.h).
+  int flags;
+} opInfo;
+
+typedef struct {
+  // Name of the type in workload spec files.
+  const char* specName;
+  // Name of the type in summaries.
+  const char* name;
+  uint64_t numOps;
+  // Stages, indexed like the type's opStats.
+  opInfo ops[NUM_STATS];
+} txTypeInfo;
+
+const txTypeInfo txTypes[NUM_TX_TYPES] = {
+    {"stream", "STREAM", 2, {
+        {"READ_USERID_STREAM", 0},
+        {"MULTIREAD_TWEET_DATA", OP_MULTI}}},
+    {"tweet", "TWEET", 9, {
+        {"INCREMENT_TWEETID", OP_NOBYTES},
+        {"WRITE_TWEETID_DATA", 0},
+        {"READ_USERID_TWEETS", 0},
+        {"WRITE_USERID_TWEETS", 0},
+        {"READ_USERID_FOLLOWERS", 0},
+        {"MULTIREAD_USERID_STREAM", OP_MULTI},
+        {"MULTIWRITE_USERID_STREAM", OP_MULTI | OP_REJECTS},
+        {"MULTIREAD_USERID_STREAMBUCKET", OP_MULTI},
+        {"MULTIWRITE_USERID_STREAMBUCKET", OP_MULTI | OP_REJECTS}}},
+    {"timeline", "TIMELINE", 2, {
+        {"READ_USERID_TWEETS", 0},
+        {"MULTIREAD_TWEET_DATA", OP_MULTI}}},
+    {"follow", "FOLLOW", 5, {
+        {"READ_FOLLOWEE_FOLLOWERS", 0},
+        {"WRITE_FOLLOWEE_FOLLOWERS", OP_REJECTS},
+        {"READ_FOLLOWEE_TWEETS", 0},
+        {"READ_USERID_STREAM", 0},
+        {"WRITE_USERID_STREAM", OP_REJECTS}}},
+    {"unfollow", "UNFOLLOW", 5, {
+        {"READ_FOLLOWEE_FOLLOWERS", 0},
+        {"WRITE_FOLLOWEE_FOLLOWERS", OP_REJECTS},
+        {"READ_FOLLOWEE_TWEETS", 0},
+        {"READ_USERID_STREAM", 0},
+        {"WRITE_USERID_STREAM", OP_REJECTS}}},
+    {"streampage", "STREAMPAGE", 2, {
+        {"READ_USERID_STREAM", 0},
+        {"MULTIREAD_TWEET_DATA", OP_MULTI}}},
+    {"readtweet", "READTWEET", 1, {
+        {"READ_TWEETID_DATA", OP_REJECTS}}},
+    {"streamsince", "STREAMSINCE", 2, {
+        {"MULTIREAD_USERID_STREAMBUCKET", OP_MULTI | OP_REJECTS},
+        {"MULTIREAD_TWEET_DATA", OP_MULTI}}},
+};
+
+static_assert((int)NUM_TX_TYPES == (int)RCDB::LATLOG_NUM_TX_TYPES,
+        "txType and RCDB::LatencyLogTxType must match");
+
+/*
+ * Client-side CPU stages of the stream and tweet transactions, i.e. the work
+ * done between RPCs. Timing for these is only compiled in when
+ * TWITTER_STAGE_TRACE is defined (make TRACE=1); otherwise the trace points
+ * below expand to nothing and cost nothing on the hot path.
+ */
+enum TraceStage {
+    TRACE_ST_KEY_SERIALIZE,
+    TRACE_ST_STREAM_PARSE,
+    TRACE_ST_MULTIREAD_PREP,
+    TRACE_ST_TWEETKEY_SERIALIZE,
+    TRACE_ST_MULTIREADOBJ_BUILD,
+    TRACE_ST_RESULT_SCAN,
+    TRACE_TW_IDKEY_SERIALIZE,
+    TRACE_TW_TWEET_SERIALIZE,
+    TRACE_TW_TWEETSKEY_SERIALIZE,
+    TRACE_TW_TWEETS_APPEND,
+    TRACE_TW_FOLLOWERSKEY_SERIALIZE,
+    TRACE_TW_MULTIREAD_PREP,
+    TRACE_TW_MULTIWRITE_PREP,
+    TRACE_TW_STREAM_APPEND,
+    TRACE_TW_REJECTRULES_BUILD,
+    TRACE_TW_MULTIWRITEOBJ_BUILD,
+    TRACE_TW_REJECT_SCAN,
+    NUM_TRACE_STAGES
+};
+
+typedef struct {
+  const char* name;
+  // True if this stage is timed inside another stage, in which case it is
+  // left out of the client CPU total to avoid counting it twice.
+  bool nested;
+} traceStageInfo;
+
+const traceStageInfo traceStages[NUM_TRACE_STAGES] = {
+    {"STREAM SERIALIZE STREAM KEY", false},
+    {"STREAM PARSE USERID STREAM", false},
+    {"STREAM PREPARE MULTIREAD", false},
+    {"  SERIALIZE TWEET KEY", true},
+    {"  BUILD MULTIREADOBJECT", true},
+    {"STREAM SCAN MULTIREAD RESULTS", false},
+    {"TWEET SERIALIZE TWEETID KEY", false},
+    {"TWEET SERIALIZE TWEET DATA", false},
+    {"TWEET SERIALIZE TWEETS KEY", false},
+    {"TWEET APPEND TO TWEETS BUFFER", false},
+    {"TWEET SERIALIZE FOLLOWERS KEY", false},
+    {"TWEET PREPARE MULTIREAD", false},
+    {"TWEET PREPARE MULTIWRITE", false},
+    {"  APPEND TO STREAM BUFFER", true},
+    {"  BUILD REJECTRULES", true},
+    {"  BUILD MULTIWRITEOBJECT", true},
+    {"TWEET SCAN MULTIWRITE STATUS", false},
+};
+
+typedef struct {
+  uint64_t totalTime;
+  uint64_t maxTime;
+  uint64_t count;
+} traceStat;
+
+#ifdef TWITTER_STAGE_TRACE
+#define STAGE_TRACE_BEGIN(stage) \
+    uint64_t stage##_traceStart = Cycles::rdtsc()
+#define STAGE_TRACE_END(stats, stage) \
+    do { \
+        uint64_t traceDelta = Cycles::rdtsc() - stage##_traceStart; \
+        stats[stage].totalTime += traceDelta; \
+        if (traceDelta > stats[stage].maxTime) \
+            stats[stage].maxTime = traceDelta; \
+        stats[stage].count++; \
+    } while (0)
+#else
+#define STAGE_TRACE_BEGIN(stage)
+#define STAGE_TRACE_END(stats, stage)
+#endif
+
+/*
+ * Load on one master, for --perMasterStats. Every object accessed counts as
+ * one op, whether it was the target of a single-object RPC or one entry of a
+ * multi-op. Latency is only meaningful for single-object RPCs: a multi-op
+ * waits for the slowest of the masters it touches.
+ */
+struct masterStat {
+  uint64_t opCount;
+  uint64_t keyBytes;
+  uint64_t valueBytes;
+  uint64_t rpcCount;
+  uint64_t rpcTime;
+  RCDB::LatencyHistogram rpcHist;
+
+  masterStat()
+    : opCount(0)
+    , keyBytes(0)
+    , valueBytes(0)
+    , rpcCount(0)
+    , rpcTime(0)
+    , rpcHist()
+  {
+  }
+
+  void merge(const masterStat& other) {
+    opCount += other.opCount;
+    keyBytes += other.keyBytes;
+    valueBytes += other.valueBytes;
+    rpcCount += other.rpcCount;
+    rpcTime += other.rpcTime;
+    rpcHist.merge(other.rpcHist);
+  }
+};
+
+/*
+ * Everything a workload thread measures, kept together so that it can be
+ * reset at the end of the warmup period and frozen at the start of the
+ * cooldown period in one step.
+ */
+struct threadStats {
+  uint64_t txTotal[NUM_TX_TYPES];
+  uint64_t txCount[NUM_TX_TYPES];
+  uint64_t streamUpdateFailures;
+  // Cycles spent waiting other than in the synchronous RPCs that opStats
+  // already time: polls in which no virtual user advanced, and replay
+  // waits for a record's time.
+  uint64_t waitTime;
+  opStat opStats[NUM_TX_TYPES][NUM_STATS];
+  traceStat traceStats[NUM_TRACE_STAGES];
+  RCDB::LatencyHistogram txHist[NUM_TX_TYPES];
+  // Keyed by the master's service locator; empty unless --perMasterStats.
+  std::map<string, masterStat> masterStats;
+
+  threadStats()
+    : txTotal()
+    , txCount()
+    , streamUpdateFailures(0)
+    , waitTime(0)
+    , opStats()
+    , traceStats()
+    , txHist()
+    , masterStats()
+  {
+  }
+
+  void reset() {
+    memset(txTotal, 0, sizeof(txTotal));
+    memset(txCount, 0, sizeof(txCount));
+    streamUpdateFailures = 0;
+    waitTime = 0;
+    memset(opStats, 0, sizeof(opStats));
+    memset(traceStats, 0, sizeof(traceStats));
+    for(uint64_t t = 0; t < NUM_TX_TYPES; t++)
+      txHist[t].reset();
+    masterStats.clear();
+  }
+
+  void merge(const threadStats& other) {
+    for(uint64_t t = 0; t < NUM_TX_TYPES; t++) {
+      txTotal[t] += other.txTotal[t];
+      txCount[t] += other.txCount[t];
+      for(uint64_t i = 0; i < NUM_STATS; i++)
+        mergeOpStat(&opStats[t][i], other.opStats[t][i]);
+      txHist[t].merge(other.txHist[t]);
+    }
+    streamUpdateFailures += other.streamUpdateFailures;
+    waitTime += other.waitTime;
+    for(uint64_t i = 0; i < NUM_TRACE_STAGES; i++) {
+      traceStats[i].totalTime += other.traceStats[i].totalTime;
+      traceStats[i].maxTime = std::max(traceStats[i].maxTime, other.traceStats[i].maxTime);
+      traceStats[i].count += other.traceStats[i].count;
+    }
+    for(std::map<string, masterStat>::const_iterator it = other.masterStats.begin(); it != other.masterStats.end(); it++)
+      masterStats[it->first].merge(it->second);
+  }
+};
+
+/*
+ * What a workload thread hands back to main() at the end of the run: its
+ * measured statistics plus the window they cover. Merging the results of all
+ * of a client's threads gives the per-client summary.
+ */
+struct threadResult {
+  threadStats stats;
+  // Lengths of the measurement window, the excluded warmup and cooldown
+  // periods, and the whole run, in seconds. Merged results keep the max.
+  double measureTime;
+  double warmupTime;
+  double cooldownTime;
+  double totalTime;
+  // Throughput over the measurement window. Merged results add these up,
+  // which stays correct even though each thread's window differs slightly.
+  double txThroughput[NUM_TX_TYPES];
+  // Wall clock time (seconds since the epoch) at which the run started.
+  // Merged results keep the earliest and latest, whose difference is the
+  // skew between the threads' measurement windows.
+  double firstStartTime;
+  double lastStartTime;
+  // Fraction of the measurement window the thread spent generating and
+  // processing transactions rather than waiting for RPCs. CPU time would not
+  // tell client and server saturation apart, since waiting threads
+  // busy-poll. Merged results add up the fractions and keep the busiest
+  // thread's, so the average is clientBusy / numThreads.
+  double clientBusy;
+  double maxClientBusy;
+  // Dispatch threads of shared clients (--threadsPerContext), set by main().
+  uint64_t dispatchThreads;
+  uint64_t numThreads;
+  // Every report interval of every thread, with its histogram, for merging
+  // into client and cluster time series (see RCDB::RunSummary).
+  std::vector<RCDB::RunSummaryInterval> intervals;
+
+  threadResult()
+    : stats()
+    , measureTime(0.0)
+    , warmupTime(0.0)
+    , cooldownTime(0.0)
+    , totalTime(0.0)
+    , txThroughput()
+    , firstStartTime(0.0)
+    , lastStartTime(0.0)
+    , clientBusy(0.0)
+    , maxClientBusy(0.0)
+    , dispatchThreads(0)
+    , numThreads(0)
+    , intervals()
+  {
+  }
+
+  void merge(const threadResult& other) {
+    stats.merge(other.stats);
+    measureTime = std::max(measureTime, other.measureTime);
+    warmupTime = std::max(warmupTime, other.warmupTime);
+    cooldownTime = std::max(cooldownTime, other.cooldownTime);
+    totalTime = std::max(totalTime, other.totalTime);
+    for(uint64_t t = 0; t < NUM_TX_TYPES; t++)
+      txThroughput[t] += other.txThroughput[t];
+    if (firstStartTime == 0.0 || other.firstStartTime < firstStartTime)
+      firstStartTime = other.firstStartTime;
+    lastStartTime = std::max(lastStartTime, other.lastStartTime);
+    clientBusy += other.clientBusy;
+    maxClientBusy = std::max(maxClientBusy, other.maxClientBusy);
+    dispatchThreads += other.dispatchThreads;
+    numThreads += other.numThreads;
+    intervals.insert(intervals.end(), other.intervals.begin(), other.intervals.end());
+  }
+};
+
+/*
+ * Pick the user a transaction acts on, either uniformly over all users or
+ * over an evenly spaced subset of workingSetSize users.
+ */
+uint64_t
+chooseUserId(uint64_t totUsers, uint64_t workingSetSize, std::mt19937_64* rng) {
+    uint64_t userID;
+    if (workingSetSize == 0) {
+        userID = ((*rng)() % totUsers) + 1;
+    } else {
+        userID = (*rng)() % workingSetSize;
+        userID = (userID * (totUsers / workingSetSize)) + 1;
+    }
+    return userID;
+}
+
+/*
+ * How often a transaction type runs and with what parameters. Not every
+ * parameter applies to every type; see readWorkloadSpec().
+ */
+typedef struct {
+  // True if the type is part of the mix (even with weight 0), in which case
+  // it appears in the summaries.
+  bool enabled;
+  double weight;
+  // Number of tweets read by stream, timeline, streampage and streamsince.
+  uint64_t pageSize;
+  // streampage reads one of pages 1..maxPages counting back from the
+  // newest page, which is the one stream reads.
+  uint64_t maxPages;
+  // Number of the followee's newest tweets follow merges into the stream.
+  uint64_t backfill;
+  // streamsince reads the tweets from up to this many seconds before the
+  // newest tweet when the thread started, up to the newest tweet...
+  uint64_t since;
+  // ...unless from is given, in which case it reads the tweets from that
+  // time on, up to the newest tweet or to (seconds since the epoch; 0 for
+  // unset).
+  uint64_t from;
+  uint64_t to;
+} txSpec;
+
+typedef struct {
+  txSpec tx[NUM_TX_TYPES];
+  double totalWeight;
+} workloadSpec;
+
+/*
+ * The mix used without a spec file: stream and tweet transactions with
+ * probability streamProb and 1 - streamProb.
+ */
+workloadSpec
+defaultWorkloadSpec(double streamProb, uint64_t pageSize) {
+    workloadSpec spec;
+    for (uint64_t t = 0; t < NUM_TX_TYPES; t++) {
+        spec.tx[t].enabled = false;
+        spec.tx[t].weight = 0.0;
+        spec.tx[t].pageSize = pageSize;
+        spec.tx[t].maxPages = 4;
+        spec.tx[t].backfill = 10;
+        spec.tx[t].since = 3600;
+        spec.tx[t].from = 0;
+        spec.tx[t].to = 0;
+    }
+    spec.tx[TX_STREAM].enabled = true;
+    spec.tx[TX_STREAM].weight = streamProb;
+    spec.tx[TX_TWEET].enabled = true;
+    spec.tx[TX_TWEET].weight = 1.0 - streamProb;
+    spec.totalWeight = 1.0;
+    return spec;
+}
+
+/*
+ * Read a workload spec file. Each line names a transaction type, its weight
+ * relative to the other lines, and optional parameters, e.g.
+ *
+ *   # type      weight  parameters
+ *   stream      80      pageSize=8
+ *   tweet       5
+ *   timeline    5       pageSize=20
+ *   follow      1       backfill=10
+ *   unfollow    1
+ *   streampage  6       pageSize=8 maxPages=4
+ *   readtweet   2
+ *   streamsince 2       pageSize=20 since=3600
+ *
+ * streamsince reads a random span of up to since seconds ending at the newest
+ * tweet, or, given from= (and optionally to=) in seconds since the epoch,
+ * that fixed range. Types not listed do not run. Parameters not given keep the values in spec,
+ * which should come from defaultWorkloadSpec().
+ *
+ * \param[out] error
+ *      Set to a description of the problem if false is returned.
+ */
+bool
+readWorkloadSpec(const string& fileName, workloadSpec* spec, string* error) {
+    std::ifstream specFile(fileName.c_str());
+    if (!specFile) {
+        *error = "could not open " + fileName;
+        return false;
+    }
+    for (uint64_t t = 0; t < NUM_TX_TYPES; t++) {
+        spec->tx[t].enabled = false;
+        spec->tx[t].weight = 0.0;
+    }
+    spec->totalWeight = 0.0;
+
+    string line;
+    uint64_t lineNumber = 0;
+    while (std::getline(specFile, line)) {
+        lineNumber++;
+        std::istringstream fields(line.substr(0, line.find('#')));
+        string typeName;
+        if (!(fields >> typeName))
+            continue;
+        uint64_t t = 0;
+        while (t < NUM_TX_TYPES && typeName != txTypes[t].specName)
+            t++;
+        txSpec* tx = (t < NUM_TX_TYPES) ? &spec->tx[t] : NULL;
+        double weight;
+        if (tx == NULL || tx->enabled || !(fields >> weight) || weight < 0.0) {
+            *error = format("%s:%lu: expected a new transaction type and a weight", fileName.c_str(), lineNumber);
+            return false;
+        }
+        tx->enabled = true;
+        tx->weight = weight;
+        spec->totalWeight += weight;
+
+        string param;
+        while (fields >> param) {
+            size_t eq = param.find('=');
+            string name = param.substr(0, eq);
+            uint64_t value = (eq != string::npos) ? strtoul(param.c_str() + eq + 1, NULL, 10) : 0;
+            if (name == "pageSize" && value > 0) {
+                tx->pageSize = value;
+            } else if (name == "maxPages" && value > 0) {
+                tx->maxPages = value;
+            } else if (name == "backfill") {
+                tx->backfill = value;
+            } else if (name == "since" && value > 0) {
+                tx->since = value;
+            } else if (name == "from" && value > 0) {
+                tx->from = value;
+            } else if (name == "to" && value > 0) {
+                tx->to = value;
+            } else {
+                *error = format("%s:%lu: bad parameter \"%s\"", fileName.c_str(), lineNumber, param.c_str());
+                return false;
+            }
+        }
+    }
+    if (spec->totalWeight <= 0.0) {
+        *error = fileName + " gives no transaction a weight";
+        return false;
+    }
+    // generateTxRequest() takes request arguments modulo these.
+    if ((spec->tx[TX_STREAMPAGE].enabled && spec->tx[TX_STREAMPAGE].maxPages == 0) ||
+            (spec->tx[TX_STREAMSINCE].enabled && spec->tx[TX_STREAMSINCE].since == 0)) {
+        *error = fileName + ": streampage needs maxPages and streamsince needs since greater than 0";
+        return false;
+    }
+    for (uint64_t t = 0; t < NUM_TX_TYPES; t++) {
+        if (spec->tx[t].to > 0 && spec->tx[t].to < spec->tx[t].from) {
+            *error = format("%s: %s has to before from", fileName.c_str(), txTypes[t].specName);
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * One transaction to run, chosen ahead of running it. What arg means depends
+ * on the type:
+ *   tweet       length of the tweet text
+ *   follow      the new follower; userId is the followee
+ *   unfollow    selects which of userId's followers unfollows
+ *   streampage  the page to read
+ *   readtweet   the tweet to read
+ *   streamsince the time (seconds since the epoch) to read from
+ * and arg2:
+ *   streamsince the time to read to, or 0 to read up to the newest tweet
+ */
+typedef struct {
+  txType type;
+  uint64_t userId;
+  uint64_t arg;
+  uint64_t arg2;
+} txRequest;
+
+/*
+ * Choose the next transaction according to the spec's weights.
+ *
+ * \param maxTweetId
+ *      Highest tweet ID readtweet may pick, and the newest tweet streamsince
+ *      counts back from.
+ * \param rng
+ *      The calling thread's generator; the requests depend only on its seed.
+ */
+txRequest
+generateTxRequest(const workloadSpec& spec, uint64_t totUsers,
+        uint64_t workingSetSize, uint64_t maxTweetId, std::mt19937_64* rng) {
+    txRequest request;
+    double randDouble = std::uniform_real_distribution<double>(0.0, spec.totalWeight)(*rng);
+    double cumulative = 0.0;
+    uint64_t t = 0;
+    for (; t < NUM_TX_TYPES - 1; t++) {
+        if (spec.tx[t].weight <= 0.0)
+            continue;
+        cumulative += spec.tx[t].weight;
+        if (randDouble <= cumulative)
+            break;
+    }
+    // Rounding may leave randDouble past the last type with any weight.
+    while (spec.tx[t].weight <= 0.0)
+        t--;
+    request.type = (txType)t;
+    request.userId = chooseUserId(totUsers, workingSetSize, rng);
+    request.arg = 0;
+    request.arg2 = 0;
+    switch (request.type) {
+    case TX_TWEET:
+        request.arg = (*rng)() % 140;
+        break;
+    case TX_FOLLOW:
+        request.arg = chooseUserId(totUsers, workingSetSize, rng);
+        if (request.arg == request.userId && totUsers > 1)
+            request.arg = request.userId % totUsers + 1;
+        break;
+    case TX_UNFOLLOW:
+        request.arg = (*rng)();
+        break;
+    case TX_STREAMPAGE:
+        request.arg = 1 + (*rng)() % spec.tx[t].maxPages;
+        break;
+    case TX_READTWEET:
+        request.arg = ((*rng)() % maxTweetId) + 1;
+        break;
+    case TX_STREAMSINCE:
+        if (spec.tx[t].from > 0) {
+            request.arg = spec.tx[t].from;
+            request.arg2 = spec.tx[t].to;
+        } else {
+            uint64_t newest = RCDB::tweetTime(maxTweetId);
+            request.arg = newest - std::min(newest, 1 + (*rng)() % spec.tx[t].since);
+        }
+        break;
+    default:
+        break;
+    }
+    return request;
+}
+
+/*
+ * Attribute one object access to the master that owns the key, according to
+ * the client's tablet map.
+ *
+ * \param elapsed
+ *      Latency of the single-object RPC in cycles, or 0 for an entry of a
+ *      multi-op.
+ */
+void
+recordMasterAccess(RamCloud* client, threadStats* stats, uint64_t tableId,
+        const string& key, uint64_t valueBytes, uint64_t elapsed) {
+    Key objectKey(tableId, key.c_str(), (uint16_t)key.length());
+    const TabletWithLocator* tablet = client->objectFinder.lookupTablet(tableId, objectKey.getHash());
+    static const string unknown("unknown");
+    masterStat& master = stats->masterStats[tablet != NULL ? tablet->serviceLocator : unknown];
+    master.opCount++;
+    master.keyBytes += key.length();
+    master.valueBytes += valueBytes;
+    if (elapsed > 0) {
+        master.rpcCount++;
+        master.rpcTime += elapsed;
+        master.rpcHist.record(Cycles::toNanoseconds(elapsed));
+    }
+}
+
+double
+epochSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/*
+ * Parse a Linux style CPU list such as "0-3,8,10-11" and append the CPUs to
+ * cpus. Returns false if the list is malformed.
+ */
+bool
+parseCpuList(const string& list, std::vector<int>* cpus) {
+    const char* p = list.c_str();
+    while (*p != '\0' && *p != '\n') {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0)
+            return false;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first)
+                return false;
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++)
+            cpus->push_back((int)cpu);
+        if (*p == ',')
+            p++;
+        else if (*p != '\0' && *p != '\n')
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Append the CPUs of the given NUMA node, as listed by the kernel, to cpus.
+ * Returns false if the node does not exist.
+ */
+bool
+numaNodeCpus(int node, std::vector<int>* cpus) {
+    string fileName = format("/sys/devices/system/node/node%d/cpulist", node);
+    std::ifstream cpuListFile(fileName.c_str());
+    string list;
+    if (!std::getline(cpuListFile, list))
+        return false;
+    return parseCpuList(list, cpus);
+}
+
+/*
+ * Block until barrierSize callers, summed over all clients, have called this
+ * function with the same key: workload threads at the start barrier, so that
+ * they all start measuring together, or clients at a sweep step.
+ *
+ * The barrier is a counter in the IDTable, such as BARRIER. Every arriving
+ * caller increments it and then polls it until it reaches the next multiple
+ * of barrierSize. Because the target is a multiple rather than an absolute
+ * value, the counter never has to be reset between runs, as long as every
+ * run uses the same barrierSize and none is aborted part way through the
+ * barrier (reloading the dataset zeroes BARRIER).
+ *
+ * \param who
+ *      Caller's name for log messages.
+ * \param timeout
+ *      Seconds to wait for the others before giving up.
+ * \return
+ *      How many times the barrier has been passed, counting this one; the
+ *      same for every caller of one round.
+ */
+uint64_t
+waitAtBarrier(RamCloud& client, uint64_t idTableId, const string& keyString,
+        uint64_t barrierSize, double timeout, const string& who) {
+    uint64_t arrived = (uint64_t)client.incrementInt64(idTableId, keyString.c_str(), (uint16_t)keyString.length(), 1);
+    uint64_t target = ((arrived - 1) / barrierSize + 1) * barrierSize;
+    
+    LOG(NOTICE, "%s: Arrived at barrier (%lu of %lu)...", who.c_str(), arrived - (target - barrierSize), barrierSize);
+    
+    uint64_t waitStart = Cycles::rdtsc();
+    Buffer buf;
+    while (true) {
+        client.read(idTableId, keyString.c_str(), (uint16_t)keyString.length(), &buf);
+        uint64_t count = *(uint64_t*)buf.getRange(0, sizeof(uint64_t));
+        if (count >= target)
+            break;
+        if (Cycles::toSeconds(Cycles::rdtsc() - waitStart) > timeout)
+            DIE("%s: Timed out at barrier with %lu of %lu; check that numClients and numThreads match across clients", who.c_str(), count - (target - barrierSize), barrierSize);
+        // Short enough to add negligible skew, long enough that hundreds of
+        // waiting threads do not swamp the master holding the counter.
+        usleep(100);
+    }
+    return target / barrierSize;
+}
+
+/*
+ * A client's share of a sweep step, as stored in its SWEEPRESULT object:
+ * throughputs plus the raw histogram of the SLO transaction type.
+ */
+struct sweepResult {
+  double throughput;
+  double sloThroughput;
+  uint64_t count;
+  uint64_t sum;
+  uint64_t min;
+  uint64_t max;
+  uint64_t buckets[RCDB::LatencyHistogram::NUM_BUCKETS];
+};
+
+/*
+ * Publish this client's result for a sweep step and merge in every other
+ * client's, so that all clients decide whether to go on from the same
+ * cluster-wide numbers. On return throughput, sloThroughput and sloHist hold
+ * the sums over all numClients clients.
+ */
+void
+exchangeSweepResults(RamCloud& client, uint64_t idTableId, uint64_t step,
+        uint64_t round, uint64_t clientIndex, uint64_t numClients,
+        double timeout, double* throughput, double* sloThroughput,
+        RCDB::LatencyHistogram* sloHist) {
+    RCDB::ProtoBuf::IDTableKey idTableKey;
+    idTableKey.set_type(RCDB::ProtoBuf::IDTableKey::SWEEPRESULT);
+    idTableKey.set_step(step);
+    idTableKey.set_round(round);
+    idTableKey.set_client(clientIndex);
+    string keyStringBuffer = idTableKey.SerializeAsString();
+    
+    sweepResult result;
+    result.throughput = *throughput;
+    result.sloThroughput = *sloThroughput;
+    result.count = sloHist->getCount();
+    result.sum = sloHist->getSum();
+    result.min = sloHist->getMin();
+    result.max = sloHist->getMax();
+    for (int b = 0; b < RCDB::LatencyHistogram::NUM_BUCKETS; b++)
+        result.buckets[b] = sloHist->getBucket(b);
+    client.write(idTableId, keyStringBuffer.c_str(), (uint16_t)keyStringBuffer.length(), &result, sizeof(result));
+    
+    // The round is new to this run, so a result that exists is this run's.
+    uint64_t waitStart = Cycles::rdtsc();
+    Buffer buf;
+    for (uint64_t c = 0; c < numClients; c++) {
+        if (c == clientIndex)
+            continue;
+        idTableKey.set_client(c);
+        keyStringBuffer = idTableKey.SerializeAsString();
+        while (true) {
+            try {
+                client.read(idTableId, keyStringBuffer.c_str(), (uint16_t)keyStringBuffer.length(), &buf);
+                break;
+            } catch (ObjectDoesntExistException& e) {
+                if (Cycles::toSeconds(Cycles::rdtsc() - waitStart) > timeout)
+                    DIE("Sweep(s%02lu): Timed out waiting for client %lu's result of step %lu", clientIndex, c, step);
+                usleep(1000);
+            }
+        }
+        if (buf.size() != sizeof(result))
+            DIE("Sweep(s%02lu): Client %lu's result of step %lu is %u bytes, not %lu; are all clients the same version?", clientIndex, c, step, buf.size(), sizeof(result));
+        buf.copy(0, sizeof(result), &result);
+        RCDB::LatencyHistogram other;
+        other.setSummary(result.count, result.sum, result.min, result.max);
+        for (int b = 0; b < RCDB::LatencyHistogram::NUM_BUCKETS; b++)
+            other.addToBucket(b, result.buckets[b]);
+        sloHist->merge(other);
+        *throughput += result.throughput;
+        *sloThroughput += result.sloThroughput;
+    }
+}
+
+enum runPhase {
+    PHASE_WARMUP,
+    PHASE_MEASURE,
+    PHASE_COOLDOWN
+};
+
+const char* runPhaseNames[] = {"W", "M", "C"};
+
+/*
+ * Append one row for one transaction type to a time series file, and keep
+ * the interval with its histogram so that the time series can be merged.
+ *
+ * \param index
+ *      Number of the interval in the thread's run, counting from zero.
+ * \param elapsed
+ *      Cycles since the thread's measurement loop started, at the end of the
+ *      interval.
+ * \param interval
+ *      Length of the interval in cycles.
+ */
+void
+writeIntervalReport(std::ofstream& tsFile, std::vector<RCDB::RunSummaryInterval>* intervals,
+        uint64_t index, uint64_t elapsed, uint64_t interval, runPhase phase,
+        const char* txType, const RCDB::LatencyHistogram& hist) {
+    RCDB::RunSummaryInterval entry;
+    entry.index = index;
+    entry.txName = txType;
+    entry.phase = runPhaseNames[phase];
+    entry.endTime = epochSeconds();
+    entry.elapsed = Cycles::toSeconds(elapsed);
+    entry.seconds = Cycles::toSeconds(interval);
+    entry.throughput = (double)hist.getCount() / entry.seconds;
+    entry.setHistogram(hist);
+    intervals->push_back(entry);
+
+    tsFile << format(TSFILE_ENTFMTSTR,
+            entry.endTime,
+            entry.elapsed,
+            entry.phase.c_str(),
+            txType,
+            hist.getCount(),
+            entry.throughput,
+            hist.getMean() / 1000.0,
+            (double)hist.getPercentile(0.5) / 1000.0,
+            (double)hist.getPercentile(0.9) / 1000.0,
+            (double)hist.getPercentile(0.99) / 1000.0,
+            (double)hist.getPercentile(0.999) / 1000.0,
+            (double)hist.getMax() / 1000.0);
+}
+
+void
+writePercentiles(std::ofstream& datFile, const char* name,
+        const RCDB::LatencyHistogram& hist) {
+    datFile << format("%-35s:%0.2fus (P90: %0.2fus, P99: %0.2fus, P99.9: %0.2fus, Max: %0.2fus)\n", name,
+            (double)hist.getPercentile(0.5) / 1000.0,
+            (double)hist.getPercentile(0.9) / 1000.0,
+            (double)hist.getPercentile(0.99) / 1000.0,
+            (double)hist.getPercentile(0.999) / 1000.0,
+            (double)hist.getMax() / 1000.0);
+}
+
+/*
+ * Write the human-readable summary of a measurement window (one thread's, or
+ * all of a client's threads merged) to a .dat file.
+ */
+void
+writeSummary(const string& datFileName, const threadResult& result,
+        const workloadSpec& spec) {
+    const threadStats& measured = result.stats;
+    
+    // Time spent blocked in RPCs; the rest of each transaction is client CPU.
+    uint64_t statRpcTotal[NUM_TX_TYPES];
+    for(uint64_t t = 0; t < NUM_TX_TYPES; t++) {
+        statRpcTotal[t] = 0;
+        for(uint64_t i = 0; i < NUM_STATS; i++)
+            statRpcTotal[t] += measured.opStats[t][i].totalTime;
+    }
+
+    std::ofstream datFile(datFileName.c_str());
+    
+    datFile << format("%-35s:%0.2fs\n", "RUNTIME", result.measureTime);
+    datFile << format("%-35s:%0.2fs (Warmup: %0.2fs, Cooldown: %0.2fs)\n", "TOTAL RUNTIME", result.totalTime, result.warmupTime, result.cooldownTime);
+    datFile << format("%-35s:%0.6f (Skew: %0.3fms)\n", "START TIME", result.firstStartTime, (result.lastStartTime - result.firstStartTime) * 1000.0);
+    datFile << format("%-35s:%0.1f%% (Max: %0.1f%%, Threads: %lu, Dispatch Threads: %lu)\n", "CLIENT BUSY", result.numThreads > 0 ? result.clientBusy / (double)result.numThreads * 100.0 : 0.0, result.maxClientBusy * 100.0, result.numThreads, result.dispatchThreads);
+    datFile << format("%-35s:%lu\n", "STREAM UPDATE FAILURES", measured.streamUpdateFailures);
+    
+    for(uint64_t t = 0; t < NUM_TX_TYPES; t++) {
+        if(!spec.tx[t].enabled)
+            continue;
+        const txTypeInfo& type = txTypes[t];
+        string name = type.name;
+        uint64_t count = measured.txCount[t];
+        datFile << format("%-35s:%lu\n", (name + " TRANSACTIONS").c_str(), count);
+        datFile << format("%-35s:%0.2ftx/s\n", (name + " TX THROUGHPUT").c_str(), count > 0 ? result.txThroughput[t] : 0.0);
+        datFile << format("%-35s:%0.2fus\n", ("AVERAGE " + name + " TX TIME").c_str(), count > 0 ? (double)Cycles::toNanoseconds(measured.txTotal[t]) / (double)count / 1000.0 : 0.0);
+        writePercentiles(datFile, (name + " TX TIME PERCENTILES").c_str(), measured.txHist[t]);
+        datFile << format("%-35s:%0.2fus\n", ("AVERAGE " + name + " TX RPC WAIT").c_str(), count > 0 ? (double)Cycles::toNanoseconds(statRpcTotal[t]) / (double)count / 1000.0 : 0.0);
+        datFile << format("%-35s:%0.2fus\n", ("AVERAGE " + name + " TX CLIENT CPU").c_str(), count > 0 ? (double)Cycles::toNanoseconds(measured.txTotal[t] - statRpcTotal[t]) / (double)count / 1000.0 : 0.0);
+        
+        for(uint64_t i = 0; i < type.numOps; i++) {
+            const opStat& op = measured.opStats[t][i];
+            int flags = type.ops[i].flags;
+            string label = string("AVERAGE ") + type.ops[i].name;
+            std::replace(label.begin(), label.end(), '_', ' ');
+            // Byte counts of multi-ops are per object.
+            uint64_t perObject = (flags & OP_MULTI) ? op.totalMultiOpSize : op.opCount;
+            double avgTime = op.opCount > 0 ? (double)Cycles::toNanoseconds(op.totalTime) / (double)op.opCount / 1000.0 : 0.0;
+            double avgKey = perObject > 0 ? (double)op.totalKeyBytes / (double)perObject : 0.0;
+            double avgValue = perObject > 0 ? (double)op.totalValueBytes / (double)perObject : 0.0;
+            string line = format("%-35s:%0.2fus", label.c_str(), avgTime);
+            if(!(flags & OP_NOBYTES)) {
+                line += format(" (Key: %0.2fB, Value: %0.2fB", avgKey, avgValue);
+                if(flags & OP_MULTI)
+                    line += format(", MOpSize: %0.2f", op.opCount > 0 ? (double)op.totalMultiOpSize / (double)op.opCount : 0.0);
+                if(flags & OP_REJECTS)
+                    line += format(", RejectCount: %lu", op.rejectCount);
+                line += ")";
+            }
+            datFile << line << "\n";
+        }
+    }
+    
+#ifdef TWITTER_STAGE_TRACE
+    // Breakdown of client CPU time by traced stage. Nested stages are
+    // already included in their enclosing stage.
+    uint64_t statTracedTotal = 0;
+    for(uint64_t i = 0; i < NUM_TRACE_STAGES; i++)
+        if(!traceStages[i].nested)
+            statTracedTotal += measured.traceStats[i].totalTime;
+    
+    datFile << format("%-35s:%0.2fs (RPC Wait: %0.2fs)\n", "TRACED CLIENT CPU", Cycles::toSeconds(statTracedTotal), Cycles::toSeconds(statRpcTotal[TX_STREAM] + statRpcTotal[TX_TWEET]));
+    for(uint64_t i = 0; i < NUM_TRACE_STAGES; i++) {
+        if(measured.traceStats[i].count > 0)
+            datFile << format("%-35s:%0.3fus (Max: %0.3fus, Count: %lu)\n", traceStages[i].name, (double)Cycles::toNanoseconds(measured.traceStats[i].totalTime) / (double)measured.traceStats[i].count / 1000.0, (double)Cycles::toNanoseconds(measured.traceStats[i].maxTime) / 1000.0, measured.traceStats[i].count);
+        else
+            datFile << format("%-35s:%0.3fus (Max: %0.3fus, Count: %lu)\n", traceStages[i].name, 0.0, 0.0, (uint64_t)0);
+    }
+#endif
+    
+    if (!measured.masterStats.empty()) {
+        // Skew is the busiest master's share of ops relative to an even split.
+        uint64_t totalOps = 0, maxOps = 0;
+        for(std::map<string, masterStat>::const_iterator it = measured.masterStats.begin(); it != measured.masterStats.end(); it++) {
+            totalOps += it->second.opCount;
+            maxOps = std::max(maxOps, it->second.opCount);
+        }
+        double meanOps = (double)totalOps / (double)measured.masterStats.size();
+        datFile << format("%-35s:%lu (Max/Mean Ops: %0.2f)\n", "MASTERS", measured.masterStats.size(), meanOps > 0.0 ? (double)maxOps / meanOps : 0.0);
+        for(std::map<string, masterStat>::const_iterator it = measured.masterStats.begin(); it != measured.masterStats.end(); it++) {
+            const masterStat& m = it->second;
+            datFile << format("%-35s:%lu ops (%0.1f%%), Key: %luB, Value: %luB, RPCs: %lu, Avg: %0.2fus, P99: %0.2fus\n", ("MASTER " + it->first).c_str(), m.opCount, totalOps > 0 ? (double)m.opCount / (double)totalOps * 100.0 : 0.0, m.keyBytes, m.valueBytes, m.rpcCount, m.rpcCount > 0 ? (double)Cycles::toNanoseconds(m.rpcTime) / (double)m.rpcCount / 1000.0 : 0.0, (double)m.rpcHist.getPercentile(0.99) / 1000.0);
+        }
+    }
+}
+
+/*
+ * Write the mergeable summary of a client's measurement window to a .sum
+ * file, for combining with other clients' using TwitterResultMerge, and the
+ * client's merged time series to tsFileName unless it is empty.
+ */
+bool
+writeRunSummary(const string& sumFileName, const string& tsFileName,
+        const threadResult& result, const workloadSpec& spec,
+        uint64_t numThreads) {
+    RCDB::RunSummary summary;
+    summary.numClients = 1;
+    summary.numThreads = numThreads;
+    summary.measureTime = result.measureTime;
+    summary.totalTime = result.totalTime;
+    summary.firstStartTime = result.firstStartTime;
+    summary.lastStartTime = result.lastStartTime;
+    summary.clientBusy = result.clientBusy;
+    summary.maxClientBusy = result.maxClientBusy;
+    summary.dispatchThreads = result.dispatchThreads;
+    
+    for(uint64_t t = 0; t < NUM_TX_TYPES; t++) {
+        if(!spec.tx[t].enabled)
+            continue;
+        RCDB::RunSummaryTx& tx = summary.tx(txTypes[t].name);
+        tx.count = result.stats.txCount[t];
+        tx.totalNs = Cycles::toNanoseconds(result.stats.txTotal[t]);
+        tx.throughput = result.txThroughput[t];
+        tx.hist = result.stats.txHist[t];
+        for(uint64_t i = 0; i < txTypes[t].numOps; i++) {
+            const opStat& from = result.stats.opStats[t][i];
+            RCDB::RunSummaryOp& op = summary.op(txTypes[t].name, txTypes[t].ops[i].name);
+            op.flags = txTypes[t].ops[i].flags;
+            op.opCount = from.opCount;
+            op.totalNs = Cycles::toNanoseconds(from.totalTime);
+            op.keyBytes = from.totalKeyBytes;
+            op.valueBytes = from.totalValueBytes;
+            op.multiOpSize = from.totalMultiOpSize;
+            op.rejectCount = from.rejectCount;
+        }
+    }
+    
+    for(std::map<string, masterStat>::const_iterator it = result.stats.masterStats.begin(); it != result.stats.masterStats.end(); it++) {
+        RCDB::RunSummaryMaster& master = summary.master(it->first);
+        master.opCount = it->second.opCount;
+        master.keyBytes = it->second.keyBytes;
+        master.valueBytes = it->second.valueBytes;
+        master.rpcCount = it->second.rpcCount;
+        master.rpcNs = Cycles::toNanoseconds(it->second.rpcTime);
+        master.rpcHist = it->second.rpcHist;
+    }
+
+    for(size_t i = 0; i < result.intervals.size(); i++)
+        summary.addInterval(result.intervals[i]);
+    if (!tsFileName.empty() && !summary.intervals.empty() &&
+            !summary.writeTimeSeries(tsFileName))
+        return false;
+    
+    return summary.write(sumFileName);
+}
+
+/*
+ * One simulated user in --numVirtualUsers mode. It runs the same stream and
+ * tweet transactions as the synchronous loop in TwitterWorkloadThread, with
+ * the same per-stage statistics, but as a non-blocking state machine over
+ * asynchronous RPCs. A single thread can then keep one transaction per
+ * virtual user outstanding and drive them all from one dispatch loop.
+ *
+ * Client-side stage trace points are not recorded in this mode.
+ */
+class TwitterVirtualUser {
+  public:
+    TwitterVirtualUser(RamCloud* client,
+            uint64_t userTableId,
+            uint64_t tweetTableId,
+            uint64_t idTableId,
+            const workloadSpec* spec,
+            uint64_t totUsers,
+            uint64_t workingSetSize,
+            uint64_t streamBucketSeconds,
+            std::mt19937_64* rng,
+            bool perMasterStats,
+            threadStats* stats,
+            RCDB::LatencyHistogram* intervalTxHist,
+            RCDB::LatencyLog* latLog)
+        : client(client)
+        , userTableId(userTableId)
+        , tweetTableId(tweetTableId)
+        , idTableId(idTableId)
+        , spec(spec)
+        , totUsers(totUsers)
+        , workingSetSize(workingSetSize)
+        , streamBucketSeconds(streamBucketSeconds)
+        , rng(rng)
+        , perMasterStats(perMasterStats)
+        , stats(stats)
+        , intervalTxHist(intervalTxHist)
+        , latLog(latLog)
+        , state(IDLE)
+        , type(TX_STREAM)
+        , userID(0)
+        , nextTweetID(0)
+        , tweetLength(0)
+        , numObjects(0)
+        , followerIds()
+        , txStart(0)
+        , opStart(0)
+        , latRecord()
+        , key()
+        , tweetData()
+        , buf()
+        , keyStringBuffer()
+        , valueStringBuffer()
+        , readRpc()
+        , writeRpc()
+        , incrementRpc()
+        , multiRead()
+        , multiWrite()
+        , capacity(0)
+        , values()
+        , valueBufs()
+        , readObjects()
+        , readRequests()
+        , writeObjects()
+        , writeRequests()
+        , rejectRules()
+        , keyStrings()
+    {
+    }
+
+    /*
+     * Advance this user's transaction as far as possible without blocking:
+     * start a new transaction if idle, or move on to the next stage if the
+     * outstanding RPC has completed. Returns false if it had to wait.
+     */
+    bool
+    poll() {
+        switch (state) {
+        case IDLE:
+            startTransaction();
+            break;
+        case ST_READ_STREAM:
+            if (!readRpc->isReady())
+                return false;
+            finishReadStream();
+            break;
+        case ST_MULTIREAD_TWEETS:
+            if (!multiRead->isReady())
+                return false;
+            finishMultiReadTweets();
+            break;
+        case TW_INCREMENT_TWEETID:
+            if (!incrementRpc->isReady())
+                return false;
+            finishIncrementTweetId();
+            break;
+        case TW_WRITE_TWEET:
+            if (!writeRpc->isReady())
+                return false;
+            finishWriteTweet();
+            break;
+        case TW_READ_TWEETS:
+            if (!readRpc->isReady())
+                return false;
+            finishReadTweets();
+            break;
+        case TW_WRITE_TWEETS:
+            if (!writeRpc->isReady())
+                return false;
+            finishWriteTweets();
+            break;
+        case TW_READ_FOLLOWERS:
+            if (!readRpc->isReady())
+                return false;
+            finishReadFollowers();
+            break;
+        case TW_MULTIREAD_STREAMS:
+            if (!multiRead->isReady())
+                return false;
+            finishMultiReadStreams();
+            break;
+        case TW_MULTIWRITE_STREAMS:
+            if (!multiWrite->isReady())
+                return false;
+            finishMultiWriteStreams();
+            break;
+        case TW_MULTIREAD_BUCKETS:
+            if (!multiRead->isReady())
+                return false;
+            finishMultiReadBuckets();
+            break;
+        case TW_MULTIWRITE_BUCKETS:
+            if (!multiWrite->isReady())
+                return false;
+            finishMultiWriteBuckets();
+            break;
+        }
+        return true;
+    }
+
+  private:
+    enum State {
+        IDLE,
+        ST_READ_STREAM,
+        ST_MULTIREAD_TWEETS,
+        TW_INCREMENT_TWEETID,
+        TW_WRITE_TWEET,
+        TW_READ_TWEETS,
+        TW_WRITE_TWEETS,
+        TW_READ_FOLLOWERS,
+        TW_MULTIREAD_STREAMS,
+        TW_MULTIWRITE_STREAMS,
+        TW_MULTIREAD_BUCKETS,
+        TW_MULTIWRITE_BUCKETS
+    };
+
+    void
+    startTransaction() {
+        txRequest request = generateTxRequest(*spec, totUsers, workingSetSize, 1, rng);
+        type = request.type;
+        userID = request.userId;
+        tweetLength = request.arg;
+        memset(&latRecord, 0, sizeof(latRecord));
+        latRecord.userId = userID;
+        latRecord.txType = type;
+        txStart = Cycles::rdtsc();
+        latRecord.timestamp = txStart;
+
+        // Only stream and tweet are supported here; main() checks the spec.
+        if (type == TX_STREAM) {
+            key.set_id(userID);
+            key.set_column(RCDB::ProtoBuf::Key::STREAM);
+            keyStringBuffer = key.SerializeAsString();
+            opStart = Cycles::rdtsc();
+            readRpc.construct(client, userTableId, keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(), &buf);
+            state = ST_READ_STREAM;
+        } else {
+            RCDB::ProtoBuf::IDTableKey idTableKey;
+            idTableKey.set_type(RCDB::ProtoBuf::IDTableKey::TWEETID);
+            keyStringBuffer = idTableKey.SerializeAsString();
+            opStart = Cycles::rdtsc();
+            incrementRpc.construct(client, idTableId, keyStringBuffer.c_str(), (uint16_t)keyStringBuffer.length(), 1);
+            state = TW_INCREMENT_TWEETID;
+        }
+    }
+
+    void
+    finishReadStream() {
+        readRpc->wait();
+        readRpc.destroy();
+        recordOp(&stats->opStats[TX_STREAM][0], 0, keyStringBuffer.length(), buf.size(), 0);
+        if (perMasterStats)
+            recordMasterAccess(client, stats, userTableId, keyStringBuffer, buf.size(), latRecord.stageLatency[0]);
+
+        uint64_t* userStream = (uint64_t*)buf.getRange(0, buf.size());
+        uint64_t userStreamLen = buf.size()/sizeof(uint64_t);
+
+        numObjects = std::min(userStreamLen, spec->tx[TX_STREAM].pageSize);
+        // An empty stream ends the transaction, as in the threaded path.
+        if (numObjects == 0) {
+            finishTransaction();
+            return;
+        }
+        reserve(numObjects);
+        for(uint64_t i = 0; i < numObjects; i++) {
+            key.set_id(userStream[userStreamLen - 1 - i]);
+            key.set_column(RCDB::ProtoBuf::Key::DATA);
+            keyStrings[i] = key.SerializeAsString();
+            readObjects[i] =
+                MultiReadObject(tweetTableId,
+                keyStrings[i].c_str(), (uint16_t)keyStrings[i].length(), &values[i]);
+            readRequests[i] = &readObjects[i];
+        }
+
+        opStart = Cycles::rdtsc();
+        multiRead.construct(client, &readRequests[0], (uint32_t)numObjects);
+        state = ST_MULTIREAD_TWEETS;
+    }
+
+    void
+    finishMultiReadTweets() {
+        multiRead->wait();
+        multiRead.destroy();
+        uint64_t keyBytes = 0, valueBytes = 0;
+        for(uint64_t i = 0; i < numObjects; i++) {
+            uint32_t valueLen;
+            values[i].get()->getValue(&valueLen);
+            keyBytes += keyStrings[i].length();
+            valueBytes += valueLen;
+            if (perMasterStats)
+                recordMasterAccess(client, stats, tweetTableId, keyStrings[i], valueLen, 0);
+        }
+        recordOp(&stats->opStats[TX_STREAM][1], 1, keyBytes, valueBytes, numObjects);
+        finishTransaction();
+    }
+
+    void
+    finishIncrementTweetId() {
+        nextTweetID = (uint64_t)incrementRpc->wait();
+        incrementRpc.destroy();
+        recordOp(&stats->opStats[TX_TWEET][0], 0, 0, 0, 0);
+        if (perMasterStats)
+            recordMasterAccess(client, stats, idTableId, keyStringBuffer, 0, latRecord.stageLatency[0]);
+
+        key.set_id(nextTweetID);
+        key.set_column(RCDB::ProtoBuf::Key::DATA);
+        tweetData.set_text(tweetString.substr(0, tweetLength));
+        tweetData.set_time(RCDB::tweetTime(nextTweetID));
+        tweetData.set_user(userID);
+        keyStringBuffer = key.SerializeAsString();
+        valueStringBuffer = tweetData.SerializeAsString();
+
+        opStart = Cycles::rdtsc();
+        writeRpc.construct(client, tweetTableId,
+                keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
+                valueStringBuffer.c_str(), (uint32_t) valueStringBuffer.length());
+        state = TW_WRITE_TWEET;
+    }
+
+    void
+    finishWriteTweet() {
+        writeRpc->wait();
+        writeRpc.destroy();
+        recordOp(&stats->opStats[TX_TWEET][1], 1, keyStringBuffer.length(), valueStringBuffer.length(), 0);
+        if (perMasterStats)
+            recordMasterAccess(client, stats, tweetTableId, keyStringBuffer, valueStringBuffer.length(), latRecord.stageLatency[1]);
+
+        key.set_id(userID);
+        key.set_column(RCDB::ProtoBuf::Key::TWEETS);
+        keyStringBuffer = key.SerializeAsString();
+
+        opStart = Cycles::rdtsc();
+        readRpc.construct(client, userTableId, keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(), &buf);
+        state = TW_READ_TWEETS;
+    }
+
+    void
+    finishReadTweets() {
+        readRpc->wait();
+        readRpc.destroy();
+        recordOp(&stats->opStats[TX_TWEET][2], 2, keyStringBuffer.length(), buf.size(), 0);
+        if (perMasterStats)
+            recordMasterAccess(client, stats, userTableId, keyStringBuffer, buf.size(), latRecord.stageLatency[2]);
+
+        buf.appendCopy((const void*)&nextTweetID, sizeof(nextTweetID));
+
+        opStart = Cycles::rdtsc();
+        writeRpc.construct(client, userTableId,
+                keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
+                buf.getRange(0, buf.size()), buf.size());
+        state = TW_WRITE_TWEETS;
+    }
+
+    void
+    finishWriteTweets() {
+        writeRpc->wait();
+        writeRpc.destroy();
+        recordOp(&stats->opStats[TX_TWEET][3], 3, keyStringBuffer.length(), buf.size(), 0);
+        if (perMasterStats)
+            recordMasterAccess(client, stats, userTableId, keyStringBuffer, buf.size(), latRecord.stageLatency[3]);
+
+        key.set_id(userID);
+        key.set_column(RCDB::ProtoBuf::Key::FOLLOWERS);
+        keyStringBuffer = key.SerializeAsString();
+
+        opStart = Cycles::rdtsc();
+        readRpc.construct(client, userTableId, keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(), &buf);
+        state = TW_READ_FOLLOWERS;
+    }
+
+    void
+    finishReadFollowers() {
+        readRpc->wait();
+        readRpc.destroy();
+        recordOp(&stats->opStats[TX_TWEET][4], 4, keyStringBuffer.length(), buf.size(), 0);
+        if (perMasterStats)
+            recordMasterAccess(client, stats, userTableId, keyStringBuffer, buf.size(), latRecord.stageLatency[4]);
+
+        uint64_t* userFollowers = (uint64_t*)buf.getRange(0, buf.size());
+        numObjects = buf.size()/sizeof(uint64_t);
+        // Nobody to fan out to.
+        if (numObjects == 0) {
+            finishTransaction();
+            return;
+        }
+        reserve(numObjects);
+        followerIds.assign(userFollowers, userFollowers + numObjects);
+        for(uint64_t i = 0; i < numObjects; i++) {
+            key.set_id(userFollowers[i]);
+            key.set_column(RCDB::ProtoBuf::Key::STREAM);
+            keyStrings[i] = key.SerializeAsString();
+            readObjects[i] =
+                    MultiReadObject(userTableId,
+                    keyStrings[i].c_str(), (uint16_t) keyStrings[i].length(), &values[i]);
+            readRequests[i] = &readObjects[i];
+        }
+
+        opStart = Cycles::rdtsc();
+        multiRead.construct(client, &readRequests[0], (uint32_t) numObjects);
+        state = TW_MULTIREAD_STREAMS;
+    }
+
+    void
+    finishMultiReadStreams() {
+        multiRead->wait();
+        multiRead.destroy();
+        uint64_t keyBytes = 0, readValueBytes = 0, writeValueBytes = 0;
+        for(uint64_t i = 0; i < numObjects; i++) {
+            uint32_t valueLen;
+            const void* value = values[i].get()->getValue(&valueLen);
+            keyBytes += keyStrings[i].length();
+            readValueBytes += valueLen;
+            if (perMasterStats)
+                recordMasterAccess(client, stats, userTableId, keyStrings[i], valueLen, 0);
+
+            // Tack the new tweet ID onto the follower's stream, and only
+            // write it back if nobody else has modified it in the meantime.
+            valueBufs[i].reset();
+            valueBufs[i].appendExternal(value, valueLen);
+            valueBufs[i].appendCopy((const void*)&nextTweetID, sizeof(nextTweetID));
+            writeValueBytes += valueBufs[i].size();
+            if (perMasterStats)
+                recordMasterAccess(client, stats, userTableId, keyStrings[i], valueBufs[i].size(), 0);
+
+            memset(&rejectRules[i], 0, sizeof(RejectRules));
+            rejectRules[i].givenVersion = values[i].get()->object.get()->getVersion();
+            rejectRules[i].versionLeGiven = 1;
+
+            writeObjects[i] =
+                    MultiWriteObject(userTableId,
+                    keyStrings[i].c_str(), (uint16_t) keyStrings[i].length(),
+                    valueBufs[i].getRange(0, valueBufs[i].size()), valueBufs[i].size(),
+                    &rejectRules[i]);
+            writeRequests[i] = &writeObjects[i];
+        }
+        recordOp(&stats->opStats[TX_TWEET][5], 5, keyBytes, readValueBytes, numObjects);
+        // Bytes for the multiwrite are known now; its time is added later.
+        stats->opStats[TX_TWEET][6].totalKeyBytes += keyBytes;
+        stats->opStats[TX_TWEET][6].totalValueBytes += writeValueBytes;
+
+        opStart = Cycles::rdtsc();
+        multiWrite.construct(client, &writeRequests[0], (uint32_t) numObjects);
+        state = TW_MULTIWRITE_STREAMS;
+    }
+
+    void
+    finishMultiWriteStreams() {
+        multiWrite->wait();
+        multiWrite.destroy();
+        recordOp(&stats->opStats[TX_TWEET][6], 6, 0, 0, numObjects);
+        for(uint64_t i = 0; i < numObjects; i++)
+            if(writeRequests[i]->status != Status::STATUS_OK)
+                stats->opStats[TX_TWEET][6].rejectCount++;
+        if (streamBucketSeconds == 0) {
+            finishTransaction();
+            return;
+        }
+
+        // Append the tweet to the followers' stream bucket for its time as
+        // well, as the threaded path does.
+        uint64_t bucket = RCDB::streamBucket(nextTweetID, streamBucketSeconds);
+        for(uint64_t i = 0; i < numObjects; i++) {
+            key.set_id(followerIds[i]);
+            key.set_column(RCDB::ProtoBuf::Key::STREAMBUCKET);
+            key.set_bucket(bucket);
+            keyStrings[i] = key.SerializeAsString();
+            readObjects[i] =
+                    MultiReadObject(userTableId,
+                    keyStrings[i].c_str(), (uint16_t) keyStrings[i].length(), &values[i]);
+            readRequests[i] = &readObjects[i];
+        }
+        key.clear_bucket();
+
+        opStart = Cycles::rdtsc();
+        multiRead.construct(client, &readRequests[0], (uint32_t) numObjects);
+        state = TW_MULTIREAD_BUCKETS;
+    }
+
+    void
+    finishMultiReadBuckets() {
+        multiRead->wait();
+        multiRead.destroy();
+        uint64_t keyBytes = 0, readValueBytes = 0, writeValueBytes = 0;
+        for(uint64_t i = 0; i < numObjects; i++) {
+            keyBytes += keyStrings[i].length();
+            memset(&rejectRules[i], 0, sizeof(RejectRules));
+            valueBufs[i].reset();
+            if (readObjects[i].status == Status::STATUS_OK) {
+                uint32_t valueLen;
+                const void* value = values[i].get()->getValue(&valueLen);
+                readValueBytes += valueLen;
+                if (perMasterStats)
+                    recordMasterAccess(client, stats, userTableId, keyStrings[i], valueLen, 0);
+                valueBufs[i].appendExternal(value, valueLen);
+                rejectRules[i].givenVersion = values[i].get()->object.get()->getVersion();
+                rejectRules[i].versionNeGiven = 1;
+            } else {
+                // A bucket nobody has posted to yet is created, and only if
+                // it still does not exist.
+                rejectRules[i].exists = 1;
+            }
+            valueBufs[i].appendCopy((const void*)&nextTweetID, sizeof(nextTweetID));
+            writeValueBytes += valueBufs[i].size();
+            if (perMasterStats)
+                recordMasterAccess(client, stats, userTableId, keyStrings[i], valueBufs[i].size(), 0);
+
+            writeObjects[i] =
+                    MultiWriteObject(userTableId,
+                    keyStrings[i].c_str(), (uint16_t) keyStrings[i].length(),
+                    valueBufs[i].getRange(0, valueBufs[i].size()), valueBufs[i].size(),
+                    &rejectRules[i]);
+            writeRequests[i] = &writeObjects[i];
+        }
+        recordOp(&stats->opStats[TX_TWEET][7], 7, keyBytes, readValueBytes, numObjects);
+        stats->opStats[TX_TWEET][8].totalKeyBytes += keyBytes;
+        stats->opStats[TX_TWEET][8].totalValueBytes += writeValueBytes;
+
+        opStart = Cycles::rdtsc();
+        multiWrite.construct(client, &writeRequests[0], (uint32_t) numObjects);
+        state = TW_MULTIWRITE_BUCKETS;
+    }
+
+    void
+    finishMultiWriteBuckets() {
+        multiWrite->wait();
+        multiWrite.destroy();
+        recordOp(&stats->opStats[TX_TWEET][8], 8, 0, 0, numObjects);
+        for(uint64_t i = 0; i < numObjects; i++)
+            if(writeRequests[i]->status != Status::STATUS_OK)
+                stats->opStats[TX_TWEET][8].rejectCount++;
+        finishTransaction();
+    }
+
+    /*
+     * Account for the RPC issued at opStart, which has just completed.
+     */
+    void
+    recordOp(opStat* op, int stage, uint64_t keyBytes, uint64_t valueBytes,
+            uint64_t multiOpSize) {
+        uint64_t elapsed = Cycles::rdtsc() - opStart;
+        op->totalTime += elapsed;
+        op->totalKeyBytes += keyBytes;
+        op->totalValueBytes += valueBytes;
+        op->totalMultiOpSize += multiOpSize;
+        op->opCount++;
+        latRecord.stageLatency[stage] = elapsed;
+        latRecord.multiOpSize[stage] = (uint32_t)multiOpSize;
+    }
+
+    void
+    finishTransaction() {
+        uint64_t elapsed = Cycles::rdtsc() - txStart;
+        stats->txTotal[type] += elapsed;
+        stats->txCount[type]++;
+        uint64_t ns = Cycles::toNanoseconds(elapsed);
+        stats->txHist[type].record(ns);
+        intervalTxHist[type].record(ns);
+        if (latLog != NULL) {
+            latRecord.latency = elapsed;
+            latLog->append(latRecord);
+        }
+        state = IDLE;
+    }
+
+    /*
+     * Make sure the multi-op arrays hold at least n entries. They only ever
+     * grow, so steady state allocates nothing.
+     */
+    void
+    reserve(uint64_t n) {
+        if (n <= capacity)
+            return;
+        capacity = std::max(n, 2 * capacity);
+        values.reset(new Tub<ObjectBuffer>[capacity]);
+        valueBufs.reset(new Buffer[capacity]);
+        readObjects.resize(capacity);
+        readRequests.resize(capacity);
+        writeObjects.resize(capacity);
+        writeRequests.resize(capacity);
+        rejectRules.resize(capacity);
+        keyStrings.resize(capacity);
+    }
+
+    RamCloud* client;
+    uint64_t userTableId;
+    uint64_t tweetTableId;
+    uint64_t idTableId;
+    const workloadSpec* spec;
+    uint64_t totUsers;
+    uint64_t workingSetSize;
+    // 0 if the dataset has no STREAMBUCKETs to maintain.
+    uint64_t streamBucketSeconds;
+    // Shared by all the thread's virtual users.
+    std::mt19937_64* rng;
+    bool perMasterStats;
+
+    // Where results go; shared by all the thread's virtual users.
+    threadStats* stats;
+    // Indexed by txType.
+    RCDB::LatencyHistogram* intervalTxHist;
+    RCDB::LatencyLog* latLog;
+
+    State state;
+    txType type;
+    uint64_t userID;
+    uint64_t nextTweetID;
+    uint64_t tweetLength;
+    // Number of objects in the current multi-op.
+    uint64_t numObjects;
+    // The tweeting user's followers, for the stream bucket stages.
+    std::vector<uint64_t> followerIds;
+    uint64_t txStart;
+    uint64_t opStart;
+    RCDB::LatencyLogRecord latRecord;
+
+    RCDB::ProtoBuf::Key key;
+    RCDB::ProtoBuf::Tweet tweetData;
+    Buffer buf;
+    string keyStringBuffer;
+    string valueStringBuffer;
+
+    // At most one of these is outstanding at a time.
+    Tub<ReadRpc> readRpc;
+    Tub<WriteRpc> writeRpc;
+    Tub<IncrementInt64Rpc> incrementRpc;
+    Tub<MultiRead> multiRead;
+    Tub<MultiWrite> multiWrite;
+
+    uint64_t capacity;
+    std::unique_ptr<Tub<ObjectBuffer>[]> values;
+    std::unique_ptr<Buffer[]> valueBufs;
+    std::vector<MultiReadObject> readObjects;
+    std::vector<MultiReadObject*> readRequests;
+    std::vector<MultiWriteObject> writeObjects;
+    std::vector<MultiWriteObject*> writeRequests;
+    std::vector<RejectRules> rejectRules;
+    std::vector<string> keyStrings;
+
+    static const string tweetString;
+
+    TwitterVirtualUser(const TwitterVirtualUser&);
+    TwitterVirtualUser& operator=(const TwitterVirtualUser&);
+};
+
+/*
+ * Heap storage for a workload thread's stream bucket multi-ops, whose size (a
+ * tweeting user's followers, a streamsince batch) does not belong on the
+ * stack. Like TwitterVirtualUser's arrays, it only ever grows.
+ */
+struct bucketScratch {
+  uint64_t capacity;
+  std::unique_ptr<Tub<ObjectBuffer>[]> values;
+  std::unique_ptr<Buffer[]> valueBufs;
+  std::vector<MultiReadObject> readObjects;
+  std::vector<MultiReadObject*> readRequests;
+  std::vector<string> keyStrings;
+
+  bucketScratch()
+    : capacity(0)
+    , values()
+    , valueBufs()
+    , readObjects()
+    , readRequests()
+    , keyStrings()
+  {
+  }
+
+  // Make sure there are at least n entries. Invalidates earlier entries.
+  void reserve(uint64_t n) {
+    if (n <= capacity)
+      return;
+    capacity = std::max(n, 2 * capacity);
+    values.reset(new Tub<ObjectBuffer>[capacity]);
+    valueBufs.reset(new Buffer[capacity]);
+    readObjects.resize(capacity);
+    readRequests.resize(capacity);
+    keyStrings.resize(capacity);
+  }
+};
+
+const string TwitterVirtualUser::tweetString = "The problem addressed here concerns a set of isolated processors, some unknown subset of which may be faulty, that communicate only by means";
+
 void
 TwitterWorkloadThread(
         OptionParser& optionParser,
         uint64_t serverNumber,
         uint64_t threadNumber,
+        int cpu,
+        RamCloud* sharedClient,
         double runTime,
-        double streamProb,
+        double warmupTime,
+        double cooldownTime,
+        double reportInterval,
+        const workloadSpec& spec,
         uint64_t totUsers,
-        uint64_t streamTxPgSize,
         uint64_t workingSetSize,
-        bool enableLatLogging,
-        string outputDir) {
+        uint64_t numVirtualUsers,
+        bool perMasterStats,
+        string barrierKey,
+        uint64_t barrierSize,
+        double barrierTimeout,
+        RCDB::LatencyLog* latLog,
+        uint64_t seed,
+        RCDB::TxTraceWriter* traceWriter,
+        RCDB::TxTraceReader* traceReader,
+        bool replayTiming,
+        string outputDir,
+        threadResult* result) {
     LOG(NOTICE, "WorkloadThread(s%02lu,t%02lu): Starting...", serverNumber, threadNumber);
 
-    LOG(NOTICE, "WorkloadThread(s%02lu,t%02lu): Connecting to coordinator at %s", serverNumber, threadNumber, optionParser.options.getCoordinatorLocator().c_str());
-    
-    // need external context to set log levels with OptionParser
-    Context context(false);
-    
-    RamCloud client(&context,
-            optionParser.options.getCoordinatorLocator().c_str(),
-            optionParser.options.getClusterName().c_str());
+    if (cpu >= 0) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpu, &cpuSet);
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+        if (error != 0)
+            DIE("WorkloadThread(s%02lu,t%02lu): Could not pin to CPU %d: %s", serverNumber, threadNumber, cpu, strerror(error));
+        LOG(NOTICE, "WorkloadThread(s%02lu,t%02lu): Pinned to CPU %d", serverNumber, threadNumber, cpu);
+    }
+
+    // Threads either share a client set up by main(), whose dispatch thread
+    // polls for all of them, or connect on their own.
+    Tub<Context> ownContext;
+    Tub<RamCloud> ownClient;
+    if (sharedClient == NULL) {
+        LOG(NOTICE, "WorkloadThread(s%02lu,t%02lu): Connecting to coordinator at %s", serverNumber, threadNumber, optionParser.options.getCoordinatorLocator().c_str());
+        
+        // need external context to set log levels with OptionParser
+        ownContext.construct(false);
+        
+        ownClient.construct(ownContext.get(),
+                optionParser.options.getCoordinatorLocator().c_str(),
+                optionParser.options.getClusterName().c_str());
+    }
+    RamCloud& client = (sharedClient != NULL) ? *sharedClient : *ownClient.get();
     
     LOG(NOTICE, "WorkloadThread(s%02lu,t%02lu): Looking for userTable and tweetTable...", serverNumber, threadNumber);
     
@@ -93,14 +1750,8 @@ TwitterWorkloadThread(
     
     LOG(NOTICE, "WorkloadThread(s%02lu,t%02lu): Found userTable (id %lu) and tweetTable (id %lu)...", serverNumber, threadNumber, userTableId, tweetTableId);
     
-    string latFileName = format("%ss%02lu_t%02lu.lat", outputDir.c_str(), serverNumber, threadNumber);
-    
-    std::ofstream latFile;
-    if(serverNumber == 0 && threadNumber == 0 && enableLatLogging) {
-        LOG(NOTICE, "WorkloadThread(s%02lu,t%02lu): Recording measurements in file %s", serverNumber, threadNumber, latFileName.c_str());
-        latFile.open(latFileName.c_str());
-        latFile << format(LATFILE_HDRFMTSTR, "#USERID", "TXTYPE", "LATENCY(us)");
-    }
+    // Per-transaction record handed to the latency log, if enabled.
+    RCDB::LatencyLogRecord latRecord;
     
     RCDB::ProtoBuf::Key key;
 //    RCDB::ProtoBuf::IDList userStream;
@@ -112,125 +1763,260 @@ TwitterWorkloadThread(
     string valueStringBuffer;
     
     string tweetString = "The problem addressed here concerns a set of isolated processors, some unknown subset of which may be faulty, that communicate only by means";
-    time_t timev;
     
-    MultiReadObject requestObjects[streamTxPgSize];
-    MultiReadObject* requests[streamTxPgSize];
-    string tweetKeyStrings[streamTxPgSize];
+    // Each thread draws from its own generator, seeded from the run's seed
+    // and the thread's identity, so a run with the same seed and thread
+    // layout issues the same transactions (in the synchronous loop).
+    uint32_t seedWords[] = {(uint32_t)seed, (uint32_t)(seed >> 32),
+            (uint32_t)serverNumber, (uint32_t)threadNumber};
+    std::seed_seq seedSeq(seedWords, seedWords + 4);
+    std::mt19937_64 rng(seedSeq);
     
-    //Tub<ObjectBuffer> values[streamTxPgSize];
+    // Sized for the largest page any transaction type reads.
+    uint64_t maxPageSize = 0;
+    for (uint64_t t = 0; t < NUM_TX_TYPES; t++)
+        if (spec.tx[t].enabled)
+            maxPageSize = std::max(maxPageSize, spec.tx[t].pageSize);
+    MultiReadObject requestObjects[maxPageSize];
+    MultiReadObject* requests[maxPageSize];
+    string tweetKeyStrings[maxPageSize];
+    // Stream bucket reads and writes, whose count is not bounded by a page.
+    bucketScratch buckets;
     
-    // Stats tracking.
-    uint64_t statLoopTimeStart, statLoopTimeEnd, statLoopTimeTotal=0;
+    // readtweet picks from the tweets that existed when the thread started,
+    // and generated streamsince ranges count back from the newest of them.
+    // Without an end time, streamsince reads up to the newest tweet this
+    // thread knows of.
+    uint64_t maxTweetId = 1;
+    if (spec.tx[TX_READTWEET].enabled || spec.tx[TX_STREAMSINCE].enabled) {
+        RCDB::ProtoBuf::IDTableKey idTableKey;
+        idTableKey.set_type(RCDB::ProtoBuf::IDTableKey::TWEETID);
+        keyStringBuffer = idTableKey.SerializeAsString();
+        client.read(idTableId, keyStringBuffer.c_str(), (uint16_t)keyStringBuffer.length(), &buf);
+        buf.copy(0, sizeof(maxTweetId), &maxTweetId);
+    }
+    if (maxTweetId == 0 && spec.tx[TX_READTWEET].weight > 0.0)
+        DIE("WorkloadThread(s%02lu,t%02lu): readtweet needs a dataset with tweets", serverNumber, threadNumber);
+    uint64_t newestTweetId = maxTweetId;
     
-    uint64_t statStTxStart, statStTxEnd, statStTxTotal=0;
-    uint64_t statStTxCount = 0;
+    // Width of the STREAMBUCKET time buckets the dataset was loaded with;
+    // 0 if it has none, in which case tweets do not maintain them.
+    uint64_t streamBucketSeconds = 0;
+    {
+        RCDB::ProtoBuf::IDTableKey idTableKey;
+        idTableKey.set_type(RCDB::ProtoBuf::IDTableKey::STREAMBUCKETSECONDS);
+        keyStringBuffer = idTableKey.SerializeAsString();
+        try {
+            client.read(idTableId, keyStringBuffer.c_str(), (uint16_t)keyStringBuffer.length(), &buf);
+            buf.copy(0, sizeof(streamBucketSeconds), &streamBucketSeconds);
+        } catch (ObjectDoesntExistException& e) {
+        }
+    }
+    if (streamBucketSeconds == 0 && spec.tx[TX_STREAMSINCE].weight > 0.0)
+        DIE("WorkloadThread(s%02lu,t%02lu): streamsince needs a dataset loaded with --streamBucketSeconds", serverNumber, threadNumber);
     
-    uint64_t statTwTxStart, statTwTxEnd, statTwTxTotal=0;
-    uint64_t statTwTxCount = 0;
-        
-    opStat stOpStats[NUM_STATS];
-    opStat twOpStats[NUM_STATS];
-
-    uint64_t startTime, totalTime;
-    uint64_t startTime2, totalTime2;
+    // Stats tracking. Everything accumulates into stats; at the end of the
+    // warmup period it is reset, and at the start of the cooldown period it
+    // is copied into measured, which is what the summary reports.
+    uint64_t statLoopTimeStart, statLoopTimeEnd;
+    uint64_t statTxStart, statTxEnd;
+    
+    threadStats stats;
+    threadStats measured;
     
-    for(uint64_t i = 0; i < NUM_STATS; i++) {
-        memset(&stOpStats[i], 0, sizeof(opStat));
-        memset(&twOpStats[i], 0, sizeof(opStat));
+    // Transaction latencies for the current report interval only.
+    RCDB::LatencyHistogram intervalTxHist[NUM_TX_TYPES];
+    
+    string tsFileName = format("%ss%02lu_t%02lu.ts", outputDir.c_str(), serverNumber, threadNumber);
+    std::ofstream tsFile;
+    if (reportInterval > 0.0) {
+        LOG(NOTICE, "WorkloadThread(s%02lu,t%02lu): Recording time series in file %s", serverNumber, threadNumber, tsFileName.c_str());
+        tsFile.open(tsFileName.c_str());
+        tsFile << format(TSFILE_HDRFMTSTR, "#EPOCH(s)", "ELAPSED(s)", "PHASE", "TXTYPE", "COUNT", "TPUT(tx/s)", "AVG(us)", "P50(us)", "P90(us)", "P99(us)", "P999(us)", "MAX(us)");
     }
     
-    uint64_t statStreamUpdateFailures = 0;
+    // In virtual user mode each of these runs one transaction at a time,
+    // and the loop below drives all of them instead of running its own.
+    Tub<TwitterVirtualUser> virtualUsers[numVirtualUsers];
+    for (uint64_t i = 0; i < numVirtualUsers; i++)
+        virtualUsers[i].construct(&client, userTableId, tweetTableId, idTableId,
+                &spec, totUsers, workingSetSize, streamBucketSeconds, &rng, perMasterStats, &stats,
+                intervalTxHist, latLog);
+    
+    if (barrierSize > 0)
+        waitAtBarrier(client, idTableId, barrierKey, barrierSize, barrierTimeout, format("WorkloadThread(s%02lu,t%02lu)", serverNumber, threadNumber));
     
+    double startWallTime = epochSeconds();
     statLoopTimeStart = Cycles::rdtsc();
-    while (Cycles::toSeconds(Cycles::rdtsc() - statLoopTimeStart) < runTime * 60.0) {
-        double randDouble = (double) rand() / (double) RAND_MAX;
-
-        if (randDouble <= streamProb) {
-            uint64_t userID;
-            if (workingSetSize == 0) {
-                userID = (rand() % totUsers) + 1;
-            } else {
-                userID = rand() % workingSetSize;
-                userID = (userID * (totUsers / workingSetSize)) + 1;
+    uint64_t runCycles = Cycles::fromSeconds(runTime * 60.0);
+    uint64_t warmupEnd = statLoopTimeStart + Cycles::fromSeconds(warmupTime);
+    uint64_t cooldownStart = statLoopTimeStart + runCycles - Cycles::fromSeconds(cooldownTime);
+    uint64_t reportCycles = Cycles::fromSeconds(reportInterval);
+    uint64_t lastReport = statLoopTimeStart;
+    uint64_t reportIndex = 0;
+    uint64_t measureStart = statLoopTimeStart;
+    uint64_t measureEnd = 0;
+    runPhase phase = (warmupTime > 0.0) ? PHASE_WARMUP : PHASE_MEASURE;
+    
+    // Next trace record to replay, read ahead while waiting for its time.
+    RCDB::TxTraceRecord traceRecord;
+    bool haveTraceRecord = false;
+    
+    while (true) {
+        uint64_t now = Cycles::rdtsc();
+        if (now - statLoopTimeStart >= runCycles)
+            break;
+        
+        if (reportCycles > 0 && now - lastReport >= reportCycles) {
+            for (uint64_t t = 0; t < NUM_TX_TYPES; t++) {
+                if (spec.tx[t].enabled)
+                    writeIntervalReport(tsFile, &result->intervals, reportIndex, now - statLoopTimeStart, now - lastReport, phase, RCDB::latLogTxTypeNames[t], intervalTxHist[t]);
+                intervalTxHist[t].reset();
             }
-
-            statStTxStart = Cycles::rdtsc();
-            
-//            startTime = Cycles::rdtsc();
+            lastReport = now;
+            reportIndex++;
+        }
+        
+        if (phase == PHASE_WARMUP && now >= warmupEnd) {
+            stats.reset();
+            measureStart = now;
+            phase = PHASE_MEASURE;
+        }
+        
+        if (phase == PHASE_MEASURE && now >= cooldownStart) {
+            measured = stats;
+            measureEnd = now;
+            phase = PHASE_COOLDOWN;
+        }
+        
+        if (numVirtualUsers > 0) {
+            uint64_t pollStart = Cycles::rdtsc();
+            if (sharedClient == NULL)
+                client.poll();
+            bool advanced = false;
+            for (uint64_t i = 0; i < numVirtualUsers; i++)
+                advanced |= virtualUsers[i]->poll();
+            if (!advanced)
+                stats.waitTime += Cycles::rdtsc() - pollStart;
+            continue;
+        }
+        
+        txRequest request;
+        if (traceReader != NULL) {
+            // Replay: the next transaction comes from the trace. With
+            // replayTiming it is held back until its recorded offset, and
+            // issued at once if the run has fallen behind.
+            if (!haveTraceRecord) {
+                if (!traceReader->next(&traceRecord)) {
+                    LOG(NOTICE, "WorkloadThread(s%02lu,t%02lu): Reached the end of the trace", serverNumber, threadNumber);
+                    break;
+                }
+                if (traceRecord.type >= NUM_TX_TYPES)
+                    DIE("WorkloadThread(s%02lu,t%02lu): Trace has unknown transaction type %u", serverNumber, threadNumber, traceRecord.type);
+                haveTraceRecord = true;
+            }
+            if (replayTiming && now - statLoopTimeStart < Cycles::fromNanoseconds(traceRecord.offsetNs)) {
+                stats.waitTime += Cycles::rdtsc() - now;
+                continue;
+            }
+            haveTraceRecord = false;
+            request.type = (txType)traceRecord.type;
+            request.userId = traceRecord.userId;
+            request.arg = traceRecord.arg;
+            request.arg2 = traceRecord.arg2;
+        } else {
+            request = generateTxRequest(spec, totUsers, workingSetSize, maxTweetId, &rng);
+        }
+        
+        if (traceWriter != NULL) {
+            RCDB::TxTraceRecord record;
+            record.offsetNs = Cycles::toNanoseconds(Cycles::rdtsc() - statLoopTimeStart);
+            record.userId = request.userId;
+            record.arg = request.arg;
+            record.arg2 = request.arg2;
+            record.type = request.type;
+            record.reserved = 0;
+            traceWriter->append(record);
+        }
+        
+        uint64_t userID = request.userId;
+        opStat* opStats = stats.opStats[request.type];
+        
+        // Stages a transaction skips must not show up in its latency record.
+        for(uint64_t i = 0; i < txTypes[request.type].numOps; i++) {
+            opStats[i].startTime = opStats[i].endTime = 0;
+            opStats[i].multiOpSize = 0;
+        }
+        
+        statTxStart = Cycles::rdtsc();
+        
+        if (request.type == TX_STREAM) {
             
+            STAGE_TRACE_BEGIN(TRACE_ST_KEY_SERIALIZE);
             key.set_id(userID);
             key.set_column(RCDB::ProtoBuf::Key::STREAM);
             keyStringBuffer = key.SerializeAsString();
+            STAGE_TRACE_END(stats.traceStats, TRACE_ST_KEY_SERIALIZE);
             
-//            totalTime = Cycles::rdtsc() - startTime;
-//            printf("time0: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime) / 1000.0);
-            
-            stOpStats[0].startTime = Cycles::rdtsc();
+            stats.opStats[TX_STREAM][0].startTime = Cycles::rdtsc();
             client.read(userTableId, keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(), &buf);
-            stOpStats[0].endTime = Cycles::rdtsc();
-            stOpStats[0].totalTime += timePassed(stOpStats[0]);
-            stOpStats[0].totalKeyBytes += (uint64_t) keyStringBuffer.length();
-            stOpStats[0].totalValueBytes += (uint64_t) buf.size();
-            stOpStats[0].opCount++;
-            
-//            startTime = Cycles::rdtsc();
+            stats.opStats[TX_STREAM][0].endTime = Cycles::rdtsc();
+            stats.opStats[TX_STREAM][0].totalTime += timePassed(stats.opStats[TX_STREAM][0]);
+            stats.opStats[TX_STREAM][0].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+            stats.opStats[TX_STREAM][0].totalValueBytes += (uint64_t) buf.size();
+            stats.opStats[TX_STREAM][0].opCount++;
+            if (perMasterStats)
+                recordMasterAccess(&client, &stats, userTableId, keyStringBuffer, buf.size(), timePassed(stats.opStats[TX_STREAM][0]));
             
+            STAGE_TRACE_BEGIN(TRACE_ST_STREAM_PARSE);
             uint64_t* userStream = (uint64_t*)buf.getRange(0, buf.size());
             uint64_t userStreamLen = buf.size()/sizeof(uint64_t);
-            
-//            totalTime = Cycles::rdtsc() - startTime;
-//            printf("time1: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime) / 1000.0);
+            STAGE_TRACE_END(stats.traceStats, TRACE_ST_STREAM_PARSE);
             
 //            printf("WorkloadThread(s%02lu,t%02lu): Read stream for user %lu (in %luus, size %d):", serverNumber, threadNumber, userID, Cycles::toMicroseconds(statStTxRdStEnd-statStTxRdStStart), buf.size());
 //            for(uint64_t i = 0; i < (uint64_t)userStreamLen; i++) 
 //                printf("%8lu", userStream[i]);
 //            printf("\n");
             
-//            startTime = Cycles::rdtsc();
-            
-            uint64_t multiReadSize = std::min(userStreamLen, streamTxPgSize);
+            STAGE_TRACE_BEGIN(TRACE_ST_MULTIREAD_PREP);
+            uint64_t multiReadSize = std::min(userStreamLen, spec.tx[TX_STREAM].pageSize);
             Tub<ObjectBuffer> values[multiReadSize];
             for(uint64_t i = 0; i < multiReadSize; i++) {
-//                startTime2 = Cycles::rdtsc();
-                
+                STAGE_TRACE_BEGIN(TRACE_ST_TWEETKEY_SERIALIZE);
                 key.set_id(userStream[userStreamLen - 1 - i]);
                 key.set_column(RCDB::ProtoBuf::Key::DATA);
                 tweetKeyStrings[i] = key.SerializeAsString();
+                STAGE_TRACE_END(stats.traceStats, TRACE_ST_TWEETKEY_SERIALIZE);
                 
-//                totalTime2 = Cycles::rdtsc() - startTime2;
-//                printf("time2.1: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime2) / 1000.0);
-                
-//                startTime2 = Cycles::rdtsc();
-                
+                STAGE_TRACE_BEGIN(TRACE_ST_MULTIREADOBJ_BUILD);
                 requestObjects[i] =
                     MultiReadObject(tweetTableId,
                     tweetKeyStrings[i].c_str(), (uint16_t)tweetKeyStrings[i].length(), &values[i]);
                 requests[i] = &requestObjects[i];
-                stOpStats[1].totalKeyBytes += tweetKeyStrings[i].length();
-                
-//                totalTime2 = Cycles::rdtsc() - startTime2;
-//                printf("time2.2: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime2) / 1000.0);
-                
+                stats.opStats[TX_STREAM][1].totalKeyBytes += tweetKeyStrings[i].length();
+                STAGE_TRACE_END(stats.traceStats, TRACE_ST_MULTIREADOBJ_BUILD);
             }
-            
-//            totalTime = Cycles::rdtsc() - startTime;
-//            printf("time2: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime) / 1000.0);
+            STAGE_TRACE_END(stats.traceStats, TRACE_ST_MULTIREAD_PREP);
             
             // Clock the multiRead.
-            stOpStats[1].startTime = Cycles::rdtsc();
+            stats.opStats[TX_STREAM][1].startTime = Cycles::rdtsc();
             client.multiRead(requests, (uint32_t)multiReadSize);
-            stOpStats[1].endTime = Cycles::rdtsc();
-            stOpStats[1].totalTime += timePassed(stOpStats[1]);
-            stOpStats[1].totalMultiOpSize += multiReadSize;
-            stOpStats[1].opCount++;
+            stats.opStats[TX_STREAM][1].endTime = Cycles::rdtsc();
+            stats.opStats[TX_STREAM][1].totalTime += timePassed(stats.opStats[TX_STREAM][1]);
+            stats.opStats[TX_STREAM][1].multiOpSize = multiReadSize;
+            stats.opStats[TX_STREAM][1].totalMultiOpSize += multiReadSize;
+            stats.opStats[TX_STREAM][1].opCount++;
             
+            STAGE_TRACE_BEGIN(TRACE_ST_RESULT_SCAN);
             for(uint64_t i = 0; i < multiReadSize; i++) {
                 uint32_t valueLen;
                 const void* value = values[i].get()->getValue(&valueLen);
                 
-                stOpStats[1].totalValueBytes += (uint64_t)valueLen;
+                stats.opStats[TX_STREAM][1].totalValueBytes += (uint64_t)valueLen;
+                if (perMasterStats)
+                    recordMasterAccess(&client, &stats, tweetTableId, tweetKeyStrings[i], valueLen, 0);
             }
+            STAGE_TRACE_END(stats.traceStats, TRACE_ST_RESULT_SCAN);
             
 //            printf("WorkloadThread(s%02lu,t%02lu): Performed stream multiread of size %lu for user %lu (in %luus) and read:\n", serverNumber, threadNumber, multiReadSize, userID, Cycles::toMicroseconds(statStTxRdTwEnd-statStTxRdTwStart));
 //            for(uint64_t i = 0; i < multiReadSize; i++) {
@@ -242,127 +2028,102 @@ TwitterWorkloadThread(
 //                printf("TweetID: %9lu, dataLen: %9d, TweeterID: %9lu, Time: %9lu, Text: %s\n", key.id(), dataLen, tweet.user(), tweet.time(), tweet.text().c_str());
 //            }
             
-            statStTxEnd = Cycles::rdtsc();
-            
-            statStTxTotal += statStTxEnd - statStTxStart;
-            
-            statStTxCount++;
-            
 //            printf("Read Stream: %5lu, MultiRead Tweets: %5lu, Total Stream Tx Time: %5lu\n", 
 //                    Cycles::toMicroseconds(statStTxRdStEnd - statStTxRdStStart),
 //                    Cycles::toMicroseconds(statStTxRdTwEnd - statStTxRdTwStart),
 //                    Cycles::toMicroseconds(statStTxEnd - statStTxStart));
             
-            if(serverNumber == 0 && threadNumber == 0 && enableLatLogging)
-                latFile << format(LATFILE_ENTFMTSTR, userID, "ST", (double)Cycles::toNanoseconds(statStTxEnd - statStTxStart)/1000.0);
-            
-        } else {
-            uint64_t userID;
-            if (workingSetSize == 0) {
-                userID = (rand() % totUsers) + 1;
-            } else {
-                userID = rand() % workingSetSize;
-                userID = (userID * (totUsers / workingSetSize)) + 1;
-            }
-            
-            statTwTxStart = Cycles::rdtsc();
+        } else if (request.type == TX_TWEET) {
             // First grab a unique tweetID
-//            startTime = Cycles::rdtsc();
-            
+            STAGE_TRACE_BEGIN(TRACE_TW_IDKEY_SERIALIZE);
             RCDB::ProtoBuf::IDTableKey idTableKey;
             idTableKey.set_type(RCDB::ProtoBuf::IDTableKey::TWEETID);
             keyStringBuffer = idTableKey.SerializeAsString();
+            STAGE_TRACE_END(stats.traceStats, TRACE_TW_IDKEY_SERIALIZE);
             
-//            totalTime = Cycles::rdtsc() - startTime;
-//            printf("time0: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime) / 1000.0);
-            
-            twOpStats[0].startTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][0].startTime = Cycles::rdtsc();
             uint64_t nextTweetID = client.incrementInt64(idTableId, keyStringBuffer.c_str(), (uint16_t)keyStringBuffer.length(), 1);
-            twOpStats[0].endTime = Cycles::rdtsc();
-            twOpStats[0].totalTime += timePassed(twOpStats[0]);
-            twOpStats[0].opCount++;
+            stats.opStats[TX_TWEET][0].endTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][0].totalTime += timePassed(stats.opStats[TX_TWEET][0]);
+            stats.opStats[TX_TWEET][0].opCount++;
+            if (perMasterStats)
+                recordMasterAccess(&client, &stats, idTableId, keyStringBuffer, 0, timePassed(stats.opStats[TX_TWEET][0]));
             
             // Create tweet in the tweet table.
-//            startTime = Cycles::rdtsc();
-            
+            STAGE_TRACE_BEGIN(TRACE_TW_TWEET_SERIALIZE);
             key.set_id(nextTweetID);
             key.set_column(RCDB::ProtoBuf::Key::DATA);
-            tweetData.set_text(tweetString.substr(0, rand() % 140));
-            time(&timev);
-            tweetData.set_time(timev);
+            tweetData.set_text(tweetString.substr(0, request.arg));
+            tweetData.set_time(RCDB::tweetTime(nextTweetID));
             tweetData.set_user(userID);
             
             keyStringBuffer = key.SerializeAsString();
             valueStringBuffer = tweetData.SerializeAsString();
-
-//            totalTime = Cycles::rdtsc() - startTime;
-//            printf("time1: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime) / 1000.0);
+            STAGE_TRACE_END(stats.traceStats, TRACE_TW_TWEET_SERIALIZE);
             
-            twOpStats[1].startTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][1].startTime = Cycles::rdtsc();
             client.write(tweetTableId,
                     keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
                     valueStringBuffer.c_str(), (uint32_t) valueStringBuffer.length());
-            twOpStats[1].endTime = Cycles::rdtsc();
-            twOpStats[1].totalTime += timePassed(twOpStats[1]);
-            twOpStats[1].totalKeyBytes += (uint64_t) keyStringBuffer.length();
-            twOpStats[1].totalValueBytes += (uint64_t) valueStringBuffer.length();
-            twOpStats[1].opCount++;
+            stats.opStats[TX_TWEET][1].endTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][1].totalTime += timePassed(stats.opStats[TX_TWEET][1]);
+            stats.opStats[TX_TWEET][1].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+            stats.opStats[TX_TWEET][1].totalValueBytes += (uint64_t) valueStringBuffer.length();
+            stats.opStats[TX_TWEET][1].opCount++;
+            if (perMasterStats)
+                recordMasterAccess(&client, &stats, tweetTableId, keyStringBuffer, valueStringBuffer.length(), timePassed(stats.opStats[TX_TWEET][1]));
             
             // Update the user's tweet list
-//            startTime = Cycles::rdtsc();
-            
+            STAGE_TRACE_BEGIN(TRACE_TW_TWEETSKEY_SERIALIZE);
             key.set_id(userID);
             key.set_column(RCDB::ProtoBuf::Key::TWEETS);
             keyStringBuffer = key.SerializeAsString();
+            STAGE_TRACE_END(stats.traceStats, TRACE_TW_TWEETSKEY_SERIALIZE);
             
-//            totalTime = Cycles::rdtsc() - startTime;
-//            printf("time2: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime) / 1000.0);
-            
-            twOpStats[2].startTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][2].startTime = Cycles::rdtsc();
             client.read(userTableId, keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(), &buf);
-            twOpStats[2].endTime = Cycles::rdtsc();
-            twOpStats[2].totalTime += timePassed(twOpStats[2]);
-            twOpStats[2].totalKeyBytes += (uint64_t) keyStringBuffer.length();
-            twOpStats[2].totalValueBytes += (uint64_t) buf.size();
-            twOpStats[2].opCount++;
-            
-//            startTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][2].endTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][2].totalTime += timePassed(stats.opStats[TX_TWEET][2]);
+            stats.opStats[TX_TWEET][2].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+            stats.opStats[TX_TWEET][2].totalValueBytes += (uint64_t) buf.size();
+            stats.opStats[TX_TWEET][2].opCount++;
+            if (perMasterStats)
+                recordMasterAccess(&client, &stats, userTableId, keyStringBuffer, buf.size(), timePassed(stats.opStats[TX_TWEET][2]));
             
+            STAGE_TRACE_BEGIN(TRACE_TW_TWEETS_APPEND);
             buf.appendCopy((const void*)&nextTweetID, sizeof(nextTweetID));
+            STAGE_TRACE_END(stats.traceStats, TRACE_TW_TWEETS_APPEND);
             
-//            totalTime = Cycles::rdtsc() - startTime;
-//            printf("time3: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime) / 1000.0);
-            
-            twOpStats[3].startTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][3].startTime = Cycles::rdtsc();
             client.write(userTableId,
                     keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
                     buf.getRange(0, buf.size()), buf.size());
-            twOpStats[3].endTime = Cycles::rdtsc();
-            twOpStats[3].totalTime += timePassed(twOpStats[3]);
-            twOpStats[3].totalKeyBytes += (uint64_t) keyStringBuffer.length();
-            twOpStats[3].totalValueBytes += (uint64_t) buf.size();
-            twOpStats[3].opCount++;
+            stats.opStats[TX_TWEET][3].endTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][3].totalTime += timePassed(stats.opStats[TX_TWEET][3]);
+            stats.opStats[TX_TWEET][3].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+            stats.opStats[TX_TWEET][3].totalValueBytes += (uint64_t) buf.size();
+            stats.opStats[TX_TWEET][3].opCount++;
+            if (perMasterStats)
+                recordMasterAccess(&client, &stats, userTableId, keyStringBuffer, buf.size(), timePassed(stats.opStats[TX_TWEET][3]));
             
             // Update the user's followers
-//            startTime = Cycles::rdtsc();
-            
+            STAGE_TRACE_BEGIN(TRACE_TW_FOLLOWERSKEY_SERIALIZE);
             key.set_id(userID);
             key.set_column(RCDB::ProtoBuf::Key::FOLLOWERS);
             keyStringBuffer = key.SerializeAsString();
+            STAGE_TRACE_END(stats.traceStats, TRACE_TW_FOLLOWERSKEY_SERIALIZE);
             
-//            totalTime = Cycles::rdtsc() - startTime;
-//            printf("time4: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime) / 1000.0);
-            
-            twOpStats[4].startTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][4].startTime = Cycles::rdtsc();
             client.read(userTableId, keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(), &buf);
-            twOpStats[4].endTime = Cycles::rdtsc();
-            twOpStats[4].totalTime += timePassed(twOpStats[4]);
-            twOpStats[4].totalKeyBytes += (uint64_t) keyStringBuffer.length();
-            twOpStats[4].totalValueBytes += (uint64_t) buf.size();
-            twOpStats[4].opCount++;
-            
-//            startTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][4].endTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][4].totalTime += timePassed(stats.opStats[TX_TWEET][4]);
+            stats.opStats[TX_TWEET][4].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+            stats.opStats[TX_TWEET][4].totalValueBytes += (uint64_t) buf.size();
+            stats.opStats[TX_TWEET][4].opCount++;
+            if (perMasterStats)
+                recordMasterAccess(&client, &stats, userTableId, keyStringBuffer, buf.size(), timePassed(stats.opStats[TX_TWEET][4]));
             
+            STAGE_TRACE_BEGIN(TRACE_TW_MULTIREAD_PREP);
             uint64_t* userFollowers = (uint64_t*)buf.getRange(0, buf.size());
             uint64_t numFollowers = buf.size()/sizeof(uint64_t);
             
@@ -385,129 +2146,570 @@ TwitterWorkloadThread(
                         MultiReadObject(userTableId,
                         userStreamKeyStrings[i].c_str(), (uint16_t) userStreamKeyStrings[i].length(), &values[i]);
                 readRequests[i] = &readRequestObjects[i];
-                twOpStats[5].totalKeyBytes += (uint64_t) userStreamKeyStrings[i].length();
+                stats.opStats[TX_TWEET][5].totalKeyBytes += (uint64_t) userStreamKeyStrings[i].length();
             }
+            STAGE_TRACE_END(stats.traceStats, TRACE_TW_MULTIREAD_PREP);
             
-//            totalTime = Cycles::rdtsc() - startTime;
-//            printf("time5: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime) / 1000.0);
-            
-            twOpStats[5].startTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][5].startTime = Cycles::rdtsc();
             client.multiRead(readRequests, (uint32_t) numFollowers);
-            twOpStats[5].endTime = Cycles::rdtsc();
-            twOpStats[5].totalTime += timePassed(twOpStats[5]);
-            twOpStats[5].totalMultiOpSize += numFollowers;
-            twOpStats[5].opCount++;
-            
-//            startTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][5].endTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][5].totalTime += timePassed(stats.opStats[TX_TWEET][5]);
+            stats.opStats[TX_TWEET][5].multiOpSize = numFollowers;
+            stats.opStats[TX_TWEET][5].totalMultiOpSize += numFollowers;
+            stats.opStats[TX_TWEET][5].opCount++;
             
+            STAGE_TRACE_BEGIN(TRACE_TW_MULTIWRITE_PREP);
             for(uint64_t i = 0; i < numFollowers; i++) {
-//                startTime2 = Cycles::rdtsc();
-                
+                STAGE_TRACE_BEGIN(TRACE_TW_STREAM_APPEND);
                 // Trigger initialization of internal Tub<Object>
                 uint32_t valueLen;
                 const void* value = values[i].get()->getValue(&valueLen);
                 
-                twOpStats[5].totalValueBytes += (uint64_t)valueLen;
+                stats.opStats[TX_TWEET][5].totalValueBytes += (uint64_t)valueLen;
+                if (perMasterStats)
+                    recordMasterAccess(&client, &stats, userTableId, userStreamKeyStrings[i], valueLen, 0);
                 
                 // Create Buffer to store ObjectBuffer value and tack on new Tweet ID
                 valueBufs[i].appendExternal(value, valueLen);
                 valueBufs[i].appendCopy((const void*)&nextTweetID, sizeof(nextTweetID));
+                STAGE_TRACE_END(stats.traceStats, TRACE_TW_STREAM_APPEND);
                 
-//                totalTime2 = Cycles::rdtsc() - startTime2;
-//                printf("time6.1: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime2) / 1000.0);
-                
-//                startTime2 = Cycles::rdtsc();
-                
+                STAGE_TRACE_BEGIN(TRACE_TW_REJECTRULES_BUILD);
                 memset(&rejectRules[i], 0, sizeof(RejectRules));
                 rejectRules[i].givenVersion = values[i].get()->object.get()->getVersion();
                 rejectRules[i].versionLeGiven = 1;
+                STAGE_TRACE_END(stats.traceStats, TRACE_TW_REJECTRULES_BUILD);
                 
-//                totalTime2 = Cycles::rdtsc() - startTime2;
-//                printf("time6.3: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime2) / 1000.0);
-                
-//                startTime2 = Cycles::rdtsc();
-                
+                STAGE_TRACE_BEGIN(TRACE_TW_MULTIWRITEOBJ_BUILD);
                 writeRequestObjects[i] = 
                         MultiWriteObject(userTableId,
                         userStreamKeyStrings[i].c_str(), (uint16_t) userStreamKeyStrings[i].length(),
                         valueBufs[i].getRange(0, valueBufs[i].size()), valueBufs[i].size(),
                         &rejectRules[i]);
                 writeRequests[i] = &writeRequestObjects[i];
-                twOpStats[6].totalKeyBytes += (uint64_t) userStreamKeyStrings[i].length();
-                twOpStats[6].totalValueBytes += (uint64_t) valueBufs[i].size();
-                
-//                totalTime2 = Cycles::rdtsc() - startTime2;
-//                printf("time6.4: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime2) / 1000.0);
+                stats.opStats[TX_TWEET][6].totalKeyBytes += (uint64_t) userStreamKeyStrings[i].length();
+                stats.opStats[TX_TWEET][6].totalValueBytes += (uint64_t) valueBufs[i].size();
+                if (perMasterStats)
+                    recordMasterAccess(&client, &stats, userTableId, userStreamKeyStrings[i], valueBufs[i].size(), 0);
+                STAGE_TRACE_END(stats.traceStats, TRACE_TW_MULTIWRITEOBJ_BUILD);
             }
+            STAGE_TRACE_END(stats.traceStats, TRACE_TW_MULTIWRITE_PREP);
             
-//            totalTime = Cycles::rdtsc() - startTime;
-//            printf("time6: %0.2fus\n", (double)Cycles::toNanoseconds(totalTime) / 1000.0);
-            
-            twOpStats[6].startTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][6].startTime = Cycles::rdtsc();
             client.multiWrite(writeRequests, (uint32_t) numFollowers);
-            twOpStats[6].endTime = Cycles::rdtsc();
-            twOpStats[6].totalTime += timePassed(twOpStats[6]);
-            twOpStats[6].totalMultiOpSize += numFollowers;
-            twOpStats[6].opCount++;
+            stats.opStats[TX_TWEET][6].endTime = Cycles::rdtsc();
+            stats.opStats[TX_TWEET][6].totalTime += timePassed(stats.opStats[TX_TWEET][6]);
+            stats.opStats[TX_TWEET][6].multiOpSize = numFollowers;
+            stats.opStats[TX_TWEET][6].totalMultiOpSize += numFollowers;
+            stats.opStats[TX_TWEET][6].opCount++;
             
+            STAGE_TRACE_BEGIN(TRACE_TW_REJECT_SCAN);
             for(uint64_t i = 0; i < numFollowers; i++)
                 if(writeRequests[i]->status != Status::STATUS_OK)
-                    twOpStats[6].rejectCount++;
+                    stats.opStats[TX_TWEET][6].rejectCount++;
+            STAGE_TRACE_END(stats.traceStats, TRACE_TW_REJECT_SCAN);
+            
+            newestTweetId = std::max(newestTweetId, nextTweetID);
+            
+            // Append the tweet to the followers' stream bucket for its time
+            // as well. A bucket nobody has posted to yet is created, and
+            // only if it still does not exist.
+            if (streamBucketSeconds > 0) {
+                uint64_t bucket = RCDB::streamBucket(nextTweetID, streamBucketSeconds);
+                buckets.reserve(numFollowers);
+                for(uint64_t i = 0; i < numFollowers; i++) {
+                    key.set_id(userFollowers[i]);
+                    key.set_column(RCDB::ProtoBuf::Key::STREAMBUCKET);
+                    key.set_bucket(bucket);
+                    buckets.keyStrings[i] = key.SerializeAsString();
+                    readRequestObjects[i] =
+                            MultiReadObject(userTableId,
+                            buckets.keyStrings[i].c_str(), (uint16_t) buckets.keyStrings[i].length(), &buckets.values[i]);
+                    readRequests[i] = &readRequestObjects[i];
+                    stats.opStats[TX_TWEET][7].totalKeyBytes += (uint64_t) buckets.keyStrings[i].length();
+                }
+                key.clear_bucket();
+                
+                stats.opStats[TX_TWEET][7].startTime = Cycles::rdtsc();
+                client.multiRead(readRequests, (uint32_t) numFollowers);
+                stats.opStats[TX_TWEET][7].endTime = Cycles::rdtsc();
+                stats.opStats[TX_TWEET][7].totalTime += timePassed(stats.opStats[TX_TWEET][7]);
+                stats.opStats[TX_TWEET][7].multiOpSize = numFollowers;
+                stats.opStats[TX_TWEET][7].totalMultiOpSize += numFollowers;
+                stats.opStats[TX_TWEET][7].opCount++;
+                
+                for(uint64_t i = 0; i < numFollowers; i++) {
+                    memset(&rejectRules[i], 0, sizeof(RejectRules));
+                    buckets.valueBufs[i].reset();
+                    if (readRequestObjects[i].status == Status::STATUS_OK) {
+                        uint32_t valueLen;
+                        const void* value = buckets.values[i].get()->getValue(&valueLen);
+                        stats.opStats[TX_TWEET][7].totalValueBytes += (uint64_t)valueLen;
+                        if (perMasterStats)
+                            recordMasterAccess(&client, &stats, userTableId, buckets.keyStrings[i], valueLen, 0);
+                        buckets.valueBufs[i].appendExternal(value, valueLen);
+                        rejectRules[i].givenVersion = buckets.values[i].get()->object.get()->getVersion();
+                        rejectRules[i].versionNeGiven = 1;
+                    } else {
+                        rejectRules[i].exists = 1;
+                    }
+                    buckets.valueBufs[i].appendCopy((const void*)&nextTweetID, sizeof(nextTweetID));
+                    writeRequestObjects[i] =
+                            MultiWriteObject(userTableId,
+                            buckets.keyStrings[i].c_str(), (uint16_t) buckets.keyStrings[i].length(),
+                            buckets.valueBufs[i].getRange(0, buckets.valueBufs[i].size()), buckets.valueBufs[i].size(),
+                            &rejectRules[i]);
+                    writeRequests[i] = &writeRequestObjects[i];
+                    stats.opStats[TX_TWEET][8].totalKeyBytes += (uint64_t) buckets.keyStrings[i].length();
+                    stats.opStats[TX_TWEET][8].totalValueBytes += (uint64_t) buckets.valueBufs[i].size();
+                    if (perMasterStats)
+                        recordMasterAccess(&client, &stats, userTableId, buckets.keyStrings[i], buckets.valueBufs[i].size(), 0);
+                }
+                
+                stats.opStats[TX_TWEET][8].startTime = Cycles::rdtsc();
+                client.multiWrite(writeRequests, (uint32_t) numFollowers);
+                stats.opStats[TX_TWEET][8].endTime = Cycles::rdtsc();
+                stats.opStats[TX_TWEET][8].totalTime += timePassed(stats.opStats[TX_TWEET][8]);
+                stats.opStats[TX_TWEET][8].multiOpSize = numFollowers;
+                stats.opStats[TX_TWEET][8].totalMultiOpSize += numFollowers;
+                stats.opStats[TX_TWEET][8].opCount++;
+                
+                for(uint64_t i = 0; i < numFollowers; i++)
+                    if(writeRequests[i]->status != Status::STATUS_OK)
+                        stats.opStats[TX_TWEET][8].rejectCount++;
+            }
+        } else if (request.type == TX_TIMELINE) {
+            // Read the user's own tweets, newest first.
+            key.set_id(userID);
+            key.set_column(RCDB::ProtoBuf::Key::TWEETS);
+            keyStringBuffer = key.SerializeAsString();
+            
+            opStats[0].startTime = Cycles::rdtsc();
+            client.read(userTableId, keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(), &buf);
+            opStats[0].endTime = Cycles::rdtsc();
+            opStats[0].totalTime += timePassed(opStats[0]);
+            opStats[0].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+            opStats[0].totalValueBytes += (uint64_t) buf.size();
+            opStats[0].opCount++;
+            if (perMasterStats)
+                recordMasterAccess(&client, &stats, userTableId, keyStringBuffer, buf.size(), timePassed(opStats[0]));
+            
+            uint64_t* userTweets = (uint64_t*)buf.getRange(0, buf.size());
+            uint64_t userTweetsLen = buf.size()/sizeof(uint64_t);
+            uint64_t multiReadSize = std::min(userTweetsLen, spec.tx[TX_TIMELINE].pageSize);
+            Tub<ObjectBuffer> values[multiReadSize];
+            for(uint64_t i = 0; i < multiReadSize; i++) {
+                key.set_id(userTweets[userTweetsLen - 1 - i]);
+                key.set_column(RCDB::ProtoBuf::Key::DATA);
+                tweetKeyStrings[i] = key.SerializeAsString();
+                requestObjects[i] =
+                    MultiReadObject(tweetTableId,
+                    tweetKeyStrings[i].c_str(), (uint16_t)tweetKeyStrings[i].length(), &values[i]);
+                requests[i] = &requestObjects[i];
+                opStats[1].totalKeyBytes += tweetKeyStrings[i].length();
+            }
+            
+            opStats[1].startTime = Cycles::rdtsc();
+            client.multiRead(requests, (uint32_t)multiReadSize);
+            opStats[1].endTime = Cycles::rdtsc();
+            opStats[1].totalTime += timePassed(opStats[1]);
+            opStats[1].multiOpSize = multiReadSize;
+            opStats[1].totalMultiOpSize += multiReadSize;
+            opStats[1].opCount++;
+            
+            for(uint64_t i = 0; i < multiReadSize; i++) {
+                uint32_t valueLen;
+                values[i].get()->getValue(&valueLen);
+                opStats[1].totalValueBytes += (uint64_t)valueLen;
+                if (perMasterStats)
+                    recordMasterAccess(&client, &stats, tweetTableId, tweetKeyStrings[i], valueLen, 0);
+            }
             
-            statTwTxEnd = Cycles::rdtsc();
-            statTwTxTotal += statTwTxEnd - statTwTxStart;
+        } else if (request.type == TX_FOLLOW || request.type == TX_UNFOLLOW) {
+            // userID is the followee. The follower joins or leaves its
+            // FOLLOWERS list, and the followee's tweets are merged into or
+            // removed from the follower's stream. Both lists are written
+            // back only if unchanged since they were read.
+            bool follow = (request.type == TX_FOLLOW);
+            uint64_t version;
+            RejectRules rejectRules;
+            memset(&rejectRules, 0, sizeof(RejectRules));
+            rejectRules.versionNeGiven = 1;
             
-            statTwTxCount++;
+            key.set_id(userID);
+            key.set_column(RCDB::ProtoBuf::Key::FOLLOWERS);
+            keyStringBuffer = key.SerializeAsString();
             
-            if(serverNumber == 0 && threadNumber == 0 && enableLatLogging)
-                latFile << format(LATFILE_ENTFMTSTR, userID, "TW", (double)Cycles::toNanoseconds(statTwTxEnd - statTwTxStart)/1000.0);
+            opStats[0].startTime = Cycles::rdtsc();
+            client.read(userTableId, keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(), &buf, NULL, &version);
+            opStats[0].endTime = Cycles::rdtsc();
+            opStats[0].totalTime += timePassed(opStats[0]);
+            opStats[0].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+            opStats[0].totalValueBytes += (uint64_t) buf.size();
+            opStats[0].opCount++;
+            if (perMasterStats)
+                recordMasterAccess(&client, &stats, userTableId, keyStringBuffer, buf.size(), timePassed(opStats[0]));
+            
+            uint64_t* followers = (uint64_t*)buf.getRange(0, buf.size());
+            uint64_t numFollowers = buf.size()/sizeof(uint64_t);
+            uint64_t followerID = 0;
+            std::vector<uint64_t> newFollowers;
+            if (follow) {
+                followerID = request.arg;
+                if (std::find(followers, followers + numFollowers, followerID) == followers + numFollowers) {
+                    newFollowers.assign(followers, followers + numFollowers);
+                    newFollowers.push_back(followerID);
+                }
+            } else if (numFollowers > 0) {
+                followerID = followers[request.arg % numFollowers];
+                newFollowers.assign(followers, followers + numFollowers);
+                newFollowers.erase(std::find(newFollowers.begin(), newFollowers.end(), followerID));
+            }
+            
+            // Nothing to do if already following, or nobody to unfollow.
+            bool updated = false;
+            if (newFollowers.size() != numFollowers) {
+                rejectRules.givenVersion = version;
+                opStats[1].startTime = Cycles::rdtsc();
+                try {
+                    client.write(userTableId,
+                            keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
+                            newFollowers.data(), (uint32_t)(newFollowers.size() * sizeof(uint64_t)),
+                            &rejectRules);
+                    updated = true;
+                } catch (RejectRulesException& e) {
+                    opStats[1].rejectCount++;
+                }
+                opStats[1].endTime = Cycles::rdtsc();
+                opStats[1].totalTime += timePassed(opStats[1]);
+                opStats[1].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+                opStats[1].totalValueBytes += (uint64_t) newFollowers.size() * sizeof(uint64_t);
+                opStats[1].opCount++;
+                if (perMasterStats)
+                    recordMasterAccess(&client, &stats, userTableId, keyStringBuffer, newFollowers.size() * sizeof(uint64_t), timePassed(opStats[1]));
+            }
+            
+            if (updated) {
+                key.set_id(userID);
+                key.set_column(RCDB::ProtoBuf::Key::TWEETS);
+                keyStringBuffer = key.SerializeAsString();
+                
+                Buffer tweetsBuf;
+                opStats[2].startTime = Cycles::rdtsc();
+                client.read(userTableId, keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(), &tweetsBuf);
+                opStats[2].endTime = Cycles::rdtsc();
+                opStats[2].totalTime += timePassed(opStats[2]);
+                opStats[2].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+                opStats[2].totalValueBytes += (uint64_t) tweetsBuf.size();
+                opStats[2].opCount++;
+                if (perMasterStats)
+                    recordMasterAccess(&client, &stats, userTableId, keyStringBuffer, tweetsBuf.size(), timePassed(opStats[2]));
+                
+                uint64_t* followeeTweets = (uint64_t*)tweetsBuf.getRange(0, tweetsBuf.size());
+                uint64_t numFolloweeTweets = tweetsBuf.size()/sizeof(uint64_t);
+                
+                key.set_id(followerID);
+                key.set_column(RCDB::ProtoBuf::Key::STREAM);
+                keyStringBuffer = key.SerializeAsString();
+                
+                opStats[3].startTime = Cycles::rdtsc();
+                client.read(userTableId, keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(), &buf, NULL, &version);
+                opStats[3].endTime = Cycles::rdtsc();
+                opStats[3].totalTime += timePassed(opStats[3]);
+                opStats[3].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+                opStats[3].totalValueBytes += (uint64_t) buf.size();
+                opStats[3].opCount++;
+                if (perMasterStats)
+                    recordMasterAccess(&client, &stats, userTableId, keyStringBuffer, buf.size(), timePassed(opStats[3]));
+                
+                // Tweet lists are in tweet ID order, since tweet IDs only
+                // grow. Loaded streams are not: the loader writes them
+                // tweet by tweet in edge-list follower order.
+                uint64_t* userStream = (uint64_t*)buf.getRange(0, buf.size());
+                uint64_t userStreamLen = buf.size()/sizeof(uint64_t);
+                std::vector<uint64_t> newStream;
+                if (follow) {
+                    uint64_t backfill = std::min(numFolloweeTweets, spec.tx[TX_FOLLOW].backfill);
+                    // Sort so the backfilled tweets land among those of
+                    // the same age, whatever order the stream was in.
+                    newStream.assign(userStream, userStream + userStreamLen);
+                    newStream.insert(newStream.end(),
+                            followeeTweets + numFolloweeTweets - backfill, followeeTweets + numFolloweeTweets);
+                    std::sort(newStream.begin(), newStream.end());
+                } else {
+                    // TWEETS is written without version checks, so racing
+                    // tweets can leave it out of order; sort a copy to search.
+                    std::vector<uint64_t> removed(followeeTweets, followeeTweets + numFolloweeTweets);
+                    std::sort(removed.begin(), removed.end());
+                    for(uint64_t i = 0; i < userStreamLen; i++)
+                        if (!std::binary_search(removed.begin(), removed.end(), userStream[i]))
+                            newStream.push_back(userStream[i]);
+                }
+                
+                rejectRules.givenVersion = version;
+                opStats[4].startTime = Cycles::rdtsc();
+                try {
+                    client.write(userTableId,
+                            keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(),
+                            newStream.data(), (uint32_t)(newStream.size() * sizeof(uint64_t)),
+                            &rejectRules);
+                } catch (RejectRulesException& e) {
+                    opStats[4].rejectCount++;
+                    stats.streamUpdateFailures++;
+                }
+                opStats[4].endTime = Cycles::rdtsc();
+                opStats[4].totalTime += timePassed(opStats[4]);
+                opStats[4].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+                opStats[4].totalValueBytes += (uint64_t) newStream.size() * sizeof(uint64_t);
+                opStats[4].opCount++;
+                if (perMasterStats)
+                    recordMasterAccess(&client, &stats, userTableId, keyStringBuffer, newStream.size() * sizeof(uint64_t), timePassed(opStats[4]));
+            }
+            
+        } else if (request.type == TX_STREAMPAGE) {
+            // Like a stream transaction, but for an older page.
+            key.set_id(userID);
+            key.set_column(RCDB::ProtoBuf::Key::STREAM);
+            keyStringBuffer = key.SerializeAsString();
+            
+            opStats[0].startTime = Cycles::rdtsc();
+            client.read(userTableId, keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(), &buf);
+            opStats[0].endTime = Cycles::rdtsc();
+            opStats[0].totalTime += timePassed(opStats[0]);
+            opStats[0].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+            opStats[0].totalValueBytes += (uint64_t) buf.size();
+            opStats[0].opCount++;
+            if (perMasterStats)
+                recordMasterAccess(&client, &stats, userTableId, keyStringBuffer, buf.size(), timePassed(opStats[0]));
+            
+            uint64_t* userStream = (uint64_t*)buf.getRange(0, buf.size());
+            uint64_t userStreamLen = buf.size()/sizeof(uint64_t);
+            uint64_t pageSize = spec.tx[TX_STREAMPAGE].pageSize;
+            uint64_t skip = std::min(userStreamLen, request.arg * pageSize);
+            uint64_t multiReadSize = std::min(userStreamLen - skip, pageSize);
+            
+            // Streams shorter than the page asked for end the transaction.
+            if (multiReadSize > 0) {
+                Tub<ObjectBuffer> values[multiReadSize];
+                for(uint64_t i = 0; i < multiReadSize; i++) {
+                    key.set_id(userStream[userStreamLen - 1 - skip - i]);
+                    key.set_column(RCDB::ProtoBuf::Key::DATA);
+                    tweetKeyStrings[i] = key.SerializeAsString();
+                    requestObjects[i] =
+                        MultiReadObject(tweetTableId,
+                        tweetKeyStrings[i].c_str(), (uint16_t)tweetKeyStrings[i].length(), &values[i]);
+                    requests[i] = &requestObjects[i];
+                    opStats[1].totalKeyBytes += tweetKeyStrings[i].length();
+                }
+                
+                opStats[1].startTime = Cycles::rdtsc();
+                client.multiRead(requests, (uint32_t)multiReadSize);
+                opStats[1].endTime = Cycles::rdtsc();
+                opStats[1].totalTime += timePassed(opStats[1]);
+                opStats[1].multiOpSize = multiReadSize;
+                opStats[1].totalMultiOpSize += multiReadSize;
+                opStats[1].opCount++;
+                
+                for(uint64_t i = 0; i < multiReadSize; i++) {
+                    uint32_t valueLen;
+                    values[i].get()->getValue(&valueLen);
+                    opStats[1].totalValueBytes += (uint64_t)valueLen;
+                    if (perMasterStats)
+                        recordMasterAccess(&client, &stats, tweetTableId, tweetKeyStrings[i], valueLen, 0);
+                }
+            }
+            
+        } else if (request.type == TX_READTWEET) {
+            // Tweet IDs are not dense, so some reads find nothing; those
+            // are counted as rejects.
+            key.set_id(request.arg);
+            key.set_column(RCDB::ProtoBuf::Key::DATA);
+            keyStringBuffer = key.SerializeAsString();
+            
+            opStats[0].startTime = Cycles::rdtsc();
+            try {
+                client.read(tweetTableId, keyStringBuffer.c_str(), (uint16_t) keyStringBuffer.length(), &buf);
+            } catch (ObjectDoesntExistException& e) {
+                buf.reset();
+                opStats[0].rejectCount++;
+            }
+            opStats[0].endTime = Cycles::rdtsc();
+            opStats[0].totalTime += timePassed(opStats[0]);
+            opStats[0].totalKeyBytes += (uint64_t) keyStringBuffer.length();
+            opStats[0].totalValueBytes += (uint64_t) buf.size();
+            opStats[0].opCount++;
+            if (perMasterStats)
+                recordMasterAccess(&client, &stats, tweetTableId, keyStringBuffer, buf.size(), timePassed(opStats[0]));
+            
+        } else if (request.type == TX_STREAMSINCE && streamBucketSeconds == 0) {
+            // Only a replayed trace gets here (the thread refuses a spec that
+            // runs streamsince on such a dataset): there are no buckets to
+            // read, so the transaction is a reject.
+            opStats[0].rejectCount++;
+            
+        } else if (request.type == TX_STREAMSINCE) {
+            // The user's stream from request.arg up to request.arg2 (or the
+            // newest tweet), newest first. Only the buckets covering that
+            // range are read, not the whole STREAM list, and only until the
+            // page is full: they are read newest first in batches of
+            // STREAMSINCE_BUCKET_BATCH. Buckets nobody posted to do not
+            // exist and are counted as rejects.
+            uint64_t rangeStart = request.arg;
+            uint64_t rangeEnd = request.arg2 > 0 ? request.arg2 : RCDB::tweetTime(newestTweetId);
+            uint64_t pageSize = spec.tx[TX_STREAMSINCE].pageSize;
+            uint64_t multiReadSize = 0;
+            Tub<ObjectBuffer> values[pageSize];
+            uint64_t firstBucket = rangeStart / streamBucketSeconds;
+            uint64_t nextBucket = rangeEnd / streamBucketSeconds;
+            bool more = rangeStart <= rangeEnd;
+            buckets.reserve(STREAMSINCE_BUCKET_BATCH);
+            while (more && multiReadSize < pageSize) {
+                uint64_t numBuckets = std::min((uint64_t)STREAMSINCE_BUCKET_BATCH, nextBucket - firstBucket + 1);
+                for(uint64_t i = 0; i < numBuckets; i++) {
+                    key.set_id(userID);
+                    key.set_column(RCDB::ProtoBuf::Key::STREAMBUCKET);
+                    key.set_bucket(nextBucket - i);
+                    buckets.keyStrings[i] = key.SerializeAsString();
+                    buckets.readObjects[i] =
+                        MultiReadObject(userTableId,
+                        buckets.keyStrings[i].c_str(), (uint16_t)buckets.keyStrings[i].length(), &buckets.values[i]);
+                    buckets.readRequests[i] = &buckets.readObjects[i];
+                    opStats[0].totalKeyBytes += buckets.keyStrings[i].length();
+                }
+                key.clear_bucket();
+                
+                uint64_t batchStart = Cycles::rdtsc();
+                if (opStats[0].multiOpSize == 0)
+                    opStats[0].startTime = batchStart;
+                client.multiRead(&buckets.readRequests[0], (uint32_t)numBuckets);
+                opStats[0].endTime = Cycles::rdtsc();
+                opStats[0].totalTime += opStats[0].endTime - batchStart;
+                opStats[0].multiOpSize += numBuckets;
+                opStats[0].totalMultiOpSize += numBuckets;
+                opStats[0].opCount++;
+                
+                // Buckets and the IDs within them are in time order, so walk
+                // the IDs backwards until the page is full.
+                for(uint64_t b = 0; b < numBuckets && multiReadSize < pageSize; b++) {
+                    if (buckets.readObjects[b].status != Status::STATUS_OK) {
+                        opStats[0].rejectCount++;
+                        continue;
+                    }
+                    uint32_t valueLen;
+                    const uint64_t* bucketTweets = (const uint64_t*)buckets.values[b].get()->getValue(&valueLen);
+                    opStats[0].totalValueBytes += (uint64_t)valueLen;
+                    if (perMasterStats)
+                        recordMasterAccess(&client, &stats, userTableId, buckets.keyStrings[b], valueLen, 0);
+                    for(uint64_t i = valueLen/sizeof(uint64_t); i-- > 0 && multiReadSize < pageSize; ) {
+                        // The first and last buckets may reach past the range.
+                        uint64_t time = RCDB::tweetTime(bucketTweets[i]);
+                        if (time > rangeEnd)
+                            continue;
+                        if (time < rangeStart)
+                            break;
+                        key.set_id(bucketTweets[i]);
+                        key.set_column(RCDB::ProtoBuf::Key::DATA);
+                        tweetKeyStrings[multiReadSize] = key.SerializeAsString();
+                        requestObjects[multiReadSize] =
+                            MultiReadObject(tweetTableId,
+                            tweetKeyStrings[multiReadSize].c_str(), (uint16_t)tweetKeyStrings[multiReadSize].length(), &values[multiReadSize]);
+                        requests[multiReadSize] = &requestObjects[multiReadSize];
+                        opStats[1].totalKeyBytes += tweetKeyStrings[multiReadSize].length();
+                        multiReadSize++;
+                    }
+                }
+                
+                if (nextBucket - firstBucket + 1 > numBuckets)
+                    nextBucket -= numBuckets;
+                else
+                    more = false;
+            }
+            
+            if (multiReadSize > 0) {
+                opStats[1].startTime = Cycles::rdtsc();
+                client.multiRead(requests, (uint32_t)multiReadSize);
+                opStats[1].endTime = Cycles::rdtsc();
+                opStats[1].totalTime += timePassed(opStats[1]);
+                opStats[1].multiOpSize = multiReadSize;
+                opStats[1].totalMultiOpSize += multiReadSize;
+                opStats[1].opCount++;
+                
+                for(uint64_t i = 0; i < multiReadSize; i++) {
+                    uint32_t valueLen;
+                    values[i].get()->getValue(&valueLen);
+                    opStats[1].totalValueBytes += (uint64_t)valueLen;
+                    if (perMasterStats)
+                        recordMasterAccess(&client, &stats, tweetTableId, tweetKeyStrings[i], valueLen, 0);
+                }
+            }
+        }
+        
+        statTxEnd = Cycles::rdtsc();
+        stats.txTotal[request.type] += statTxEnd - statTxStart;
+        
+        stats.txCount[request.type]++;
+        
+        uint64_t txNs = Cycles::toNanoseconds(statTxEnd - statTxStart);
+        stats.txHist[request.type].record(txNs);
+        intervalTxHist[request.type].record(txNs);
+        
+        if(latLog != NULL) {
+            memset(&latRecord, 0, sizeof(latRecord));
+            latRecord.timestamp = statTxStart;
+            latRecord.userId = userID;
+            latRecord.latency = statTxEnd - statTxStart;
+            latRecord.txType = request.type;
+            for(uint64_t i = 0; i < txTypes[request.type].numOps; i++) {
+                latRecord.stageLatency[i] = timePassed(opStats[i]);
+                latRecord.multiOpSize[i] = (uint32_t)opStats[i].multiOpSize;
+            }
+            latLog->append(latRecord);
         }
     }
     statLoopTimeEnd = Cycles::rdtsc();
     
-    statLoopTimeTotal = statLoopTimeEnd - statLoopTimeStart;
-
-    if(serverNumber == 0 && threadNumber == 0 && enableLatLogging)
-        latFile.close();
-
-    string datFileName = format("%ss%02lu_t%02lu.dat", outputDir.c_str(), serverNumber, threadNumber);
-    LOG(NOTICE, "WorkloadThread(s%02lu,t%02lu): Recording summary information in file %s", serverNumber, threadNumber, datFileName.c_str());
-    std::ofstream datFile(datFileName.c_str());
+    // With no cooldown period, the measurement runs to the end of the loop.
+    if (phase != PHASE_COOLDOWN) {
+        measured = stats;
+        measureEnd = statLoopTimeEnd;
+    }
+    uint64_t statMeasureTimeTotal = measureEnd - measureStart;
     
-    datFile << format("%-35s:%0.2fs\n", "RUNTIME", Cycles::toSeconds(statLoopTimeTotal));
-    datFile << format("%-35s:%lu\n", "STREAM UPDATE FAILURES", statStreamUpdateFailures);
+    if (reportCycles > 0) {
+        for (uint64_t t = 0; t < NUM_TX_TYPES; t++)
+            if (spec.tx[t].enabled)
+                writeIntervalReport(tsFile, &result->intervals, reportIndex, statLoopTimeEnd - statLoopTimeStart, statLoopTimeEnd - lastReport, phase, RCDB::latLogTxTypeNames[t], intervalTxHist[t]);
+        tsFile.close();
+    }
     
-    datFile << format("%-35s:%lu\n", "STREAM TRANSACTIONS", statStTxCount);
-    if(statStTxCount > 0) {
-        datFile << format("%-35s:%0.2fus\n", "AVERAGE STREAM TX TIME", (double)Cycles::toNanoseconds(statStTxTotal) / (double)statStTxCount / 1000.0);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB)\n", "AVERAGE READ USERID STREAM", (double)Cycles::toNanoseconds(stOpStats[0].totalTime) / (double)stOpStats[0].opCount / 1000.0, (double)stOpStats[0].totalKeyBytes / (double)stOpStats[0].opCount, (double)stOpStats[0].totalValueBytes / (double)stOpStats[0].opCount);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB, MOpSize: %0.2f)\n", "AVERAGE MULTIREAD TWEET DATA", (double)Cycles::toNanoseconds(stOpStats[1].totalTime) / (double)stOpStats[1].opCount / 1000.0, (double)stOpStats[1].totalKeyBytes / (double)stOpStats[1].totalMultiOpSize, (double)stOpStats[1].totalValueBytes / (double)stOpStats[1].totalMultiOpSize, (double)stOpStats[1].totalMultiOpSize / (double)stOpStats[1].opCount);
-    } else {
-        datFile << format("%-35s:%0.2fus\n", "AVERAGE STREAM TX TIME", 0.0);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB)\n", "AVERAGE READ USERID STREAM", 0.0, 0.0, 0.0);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB, MOpSize: %0.2f)\n", "AVERAGE MULTIREAD TWEET DATA", 0.0, 0.0, 0.0, 0.0);
-    }
-    
-    datFile << format("%-35s:%lu\n", "TWEET TRANSACTIONS", statTwTxCount);
-    if(statTwTxCount > 0) {
-        datFile << format("%-35s:%0.2fus\n", "AVERAGE TWEET TX TIME", (double)Cycles::toNanoseconds(statTwTxTotal) / (double)statTwTxCount / 1000.0);
-        datFile << format("%-35s:%0.2fus\n", "AVERAGE INCREMENT TWEETID", (double)Cycles::toNanoseconds(twOpStats[0].totalTime) / (double)twOpStats[0].opCount / 1000.0);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB)\n", "AVERAGE WRITE TWEETID DATA", (double)Cycles::toNanoseconds(twOpStats[1].totalTime) / (double)twOpStats[1].opCount / 1000.0, (double)twOpStats[1].totalKeyBytes / (double)twOpStats[1].opCount, (double)twOpStats[1].totalValueBytes / (double)twOpStats[1].opCount);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB)\n", "AVERAGE READ USERID TWEETS", (double)Cycles::toNanoseconds(twOpStats[2].totalTime) / (double)twOpStats[2].opCount / 1000.0, (double)twOpStats[2].totalKeyBytes / (double)twOpStats[2].opCount, (double)twOpStats[2].totalValueBytes / (double)twOpStats[2].opCount);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB)\n", "AVERAGE WRITE USERID TWEETS", (double)Cycles::toNanoseconds(twOpStats[3].totalTime) / (double)twOpStats[3].opCount / 1000.0, (double)twOpStats[3].totalKeyBytes / (double)twOpStats[3].opCount, (double)twOpStats[3].totalValueBytes / (double)twOpStats[3].opCount);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB)\n", "AVERAGE READ USERID FOLLOWERS", (double)Cycles::toNanoseconds(twOpStats[4].totalTime) / (double)twOpStats[4].opCount / 1000.0, (double)twOpStats[4].totalKeyBytes / (double)twOpStats[4].opCount, (double)twOpStats[4].totalValueBytes / (double)twOpStats[4].opCount);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB, MOpSize: %0.2f)\n", "AVERAGE MULTIREAD USERID STREAM", (double)Cycles::toNanoseconds(twOpStats[5].totalTime) / (double)twOpStats[5].opCount / 1000.0, (double)twOpStats[5].totalKeyBytes / (double)twOpStats[5].totalMultiOpSize, (double)twOpStats[5].totalValueBytes / (double)twOpStats[5].totalMultiOpSize, (double)twOpStats[5].totalMultiOpSize / (double)twOpStats[5].opCount);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB, MOpSize: %0.2f, RejectCount: %lu)\n", "AVERAGE MULTIWRITE USERID STREAM", (double)Cycles::toNanoseconds(twOpStats[6].totalTime) / (double)twOpStats[6].opCount / 1000.0, (double)twOpStats[6].totalKeyBytes / (double)twOpStats[6].totalMultiOpSize, (double)twOpStats[6].totalValueBytes / (double)twOpStats[6].totalMultiOpSize, (double)twOpStats[6].totalMultiOpSize / (double)twOpStats[6].opCount, twOpStats[6].rejectCount);
-    } else {
-        datFile << format("%-35s:%0.2fus\n", "AVERAGE TWEET TX TIME", 0.0);
-        datFile << format("%-35s:%0.2fus\n", "AVERAGE INCREMENT TWEETID", 0.0);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB)\n", "AVERAGE WRITE TWEETID DATA", 0.0, 0.0, 0.0);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB)\n", "AVERAGE READ USERID TWEETS", 0.0, 0.0, 0.0);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB)\n", "AVERAGE WRITE USERID TWEETS", 0.0, 0.0, 0.0);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB)\n", "AVERAGE READ USERID FOLLOWERS", 0.0, 0.0, 0.0);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB, MOpSize: %0.2f)\n", "AVERAGE MULTIREAD USERID STREAM", 0.0, 0.0, 0.0, 0.0);
-        datFile << format("%-35s:%0.2fus (Key: %0.2fB, Value: %0.2fB, MOpSize: %0.2f, RejectCount: %lu)\n", "AVERAGE MULTIWRITE USERID STREAM", 0.0, 0.0, 0.0, 0.0, (uint64_t)0);
+    result->stats = measured;
+    result->measureTime = Cycles::toSeconds(statMeasureTimeTotal);
+    result->warmupTime = Cycles::toSeconds(measureStart - statLoopTimeStart);
+    result->cooldownTime = Cycles::toSeconds(statLoopTimeEnd - measureEnd);
+    result->totalTime = Cycles::toSeconds(statLoopTimeEnd - statLoopTimeStart);
+    // A run that ends before the warmup does has no measurement window;
+    // report zero rather than writing inf/NaN into the summaries.
+    for (uint64_t t = 0; t < NUM_TX_TYPES; t++)
+        result->txThroughput[t] = result->measureTime > 0.0 ?
+                (double)measured.txCount[t] / result->measureTime : 0.0;
+    result->firstStartTime = startWallTime;
+    result->lastStartTime = startWallTime;
+    // Synchronous transactions wait for one RPC at a time, timed by their
+    // stages; virtual users' RPCs overlap, so their polls are timed instead.
+    uint64_t waitCycles = measured.waitTime;
+    if (numVirtualUsers == 0) {
+        for (uint64_t t = 0; t < NUM_TX_TYPES; t++)
+            for (uint64_t i = 0; i < NUM_STATS; i++)
+                waitCycles += measured.opStats[t][i].totalTime;
     }
+    result->clientBusy = statMeasureTimeTotal > 0 ?
+            1.0 - (double)std::min(waitCycles, statMeasureTimeTotal) / (double)statMeasureTimeTotal : 0.0;
+    result->maxClientBusy = result->clientBusy;
+    result->numThreads = 1;
+    
+    string datFileName = format("%ss%02lu_t%02lu.dat", outputDir.c_str(), serverNumber, threadNumber);
+    LOG(NOTICE, "WorkloadThread(s%02lu,t%02lu): Recording summary information in file %s", serverNumber, threadNumber, datFileName.c_str());
+    writeSummary(datFileName, *result, spec);
 }
 
 int
@@ -519,11 +2721,31 @@ try {
     uint64_t numClients;
     uint64_t numThreads;
     double runTime;
+    double warmupTime;
+    double cooldownTime;
+    double reportInterval;
     double streamProb;
     uint64_t totUsers;
     uint64_t streamTxPgSize;
     uint64_t workingSetSize;
+    string workloadSpecFile;
+    uint64_t numVirtualUsers;
+    string cpuList;
+    string numaNodes;
+    uint64_t threadsPerContext;
+    bool perMasterStats;
+    bool startBarrier;
+    double barrierTimeout;
     bool enableLatLogging;
+    uint64_t latLogBufferSize;
+    uint64_t seed;
+    bool recordTrace;
+    string replayTrace;
+    bool replayTiming;
+    uint64_t sweepStep;
+    uint64_t sweepMaxThreads;
+    string sweepSloTx;
+    double sweepSloP99;
     string outputDir;
 
     // Set line buffering for stdout so that printf's and log messages
@@ -551,6 +2773,18 @@ try {
             ProgramOptions::value<double>(&runTime)->
                 default_value(0.1),
             "Total time to run (minutes; default 0.1).")
+            ("warmupTime",
+            ProgramOptions::value<double>(&warmupTime)->
+                default_value(0.0),
+            "Time at the start of the run excluded from the summary (seconds; default 0).")
+            ("cooldownTime",
+            ProgramOptions::value<double>(&cooldownTime)->
+                default_value(0.0),
+            "Time at the end of the run excluded from the summary (seconds; default 0).")
+            ("reportInterval",
+            ProgramOptions::value<double>(&reportInterval)->
+                default_value(1.0),
+            "Interval at which each thread appends throughput and latency percentiles to its .ts time series (seconds; 0 to disable; default 1).")
             ("streamProb",
             ProgramOptions::value<double>(&streamProb)->
                 default_value(0.9),
@@ -566,10 +2800,78 @@ try {
             ProgramOptions::value<uint64_t>(&workingSetSize)->
                 default_value(0),
             "Number of users over which to apply workload (0 for all users; default 0).")
+            ("workloadSpec",
+            ProgramOptions::value<string>(&workloadSpecFile)->
+                default_value(""),
+            "File listing the transaction types to run (stream, tweet, timeline, follow, unfollow, streampage, readtweet, streamsince), their weights and parameters; replaces streamProb (default: stream and tweet only).")
+            ("numVirtualUsers",
+            ProgramOptions::value<uint64_t>(&numVirtualUsers)->
+                default_value(0),
+            "Number of simulated users per thread, each with one transaction outstanding at a time using asynchronous RPCs (0 to run one synchronous transaction at a time; default 0).")
+            ("cpuList",
+            ProgramOptions::value<string>(&cpuList)->
+                default_value(""),
+            "Pin workload threads round-robin to these CPUs, e.g. \"0-7,16-23\" (default: not pinned).")
+            ("numaNodes",
+            ProgramOptions::value<string>(&numaNodes)->
+                default_value(""),
+            "Pin workload threads round-robin to the CPUs of these NUMA nodes, e.g. \"0,1\"; ignored if cpuList is given (default: not pinned).")
+            ("threadsPerContext",
+            ProgramOptions::value<uint64_t>(&threadsPerContext)->
+                default_value(1),
+            "Number of workload threads sharing one RAMCloud client and its dispatch thread (1 for a private client per thread; default 1).")
+            ("perMasterStats",
+            ProgramOptions::value<bool>(&perMasterStats)->
+                default_value(false),
+            "Attribute every object access to the master owning its key and report op counts, bytes and RPC latency per master (default false).")
+            ("startBarrier",
+            ProgramOptions::value<bool>(&startBarrier)->
+                default_value(false),
+            "Wait until all numThreads threads across all clients are connected, then start them together so that their measurement windows line up (default false).")
+            ("barrierTimeout",
+            ProgramOptions::value<double>(&barrierTimeout)->
+                default_value(300.0),
+            "Time to wait at the start barrier before giving up (seconds; default 300).")
             ("enableLatLogging",
             ProgramOptions::value<bool>(&enableLatLogging)->
                 default_value(false),
-            "Enable outputting of each individual latency measurement (default false).")
+            "Enable outputting of each individual latency measurement, for all threads, to binary .blat files (convert with TwitterLatLogConvert; default false).")
+            ("latLogBufferSize",
+            ProgramOptions::value<uint64_t>(&latLogBufferSize)->
+                default_value(65536),
+            "Per-thread latency log ring size in records; records that do not fit are dropped and counted (default 65536).")
+            ("seed",
+            ProgramOptions::value<uint64_t>(&seed)->
+                default_value(0),
+            "Seed for the threads' transaction generators; runs with the same seed, clientIndex and threads issue the same transactions (0 to pick one and log it; default 0).")
+            ("recordTrace",
+            ProgramOptions::value<bool>(&recordTrace)->
+                default_value(false),
+            "Record every transaction issued, with its parameters and time, to a binary sNN_tNN.trc trace per thread (see TxTrace.h; default false).")
+            ("replayTrace",
+            ProgramOptions::value<string>(&replayTrace)->
+                default_value(""),
+            "Directory of sNN_tNN.trc traces to reissue instead of generating transactions; each thread replays its own trace until it ends or runTime is up (default: generate).")
+            ("replayTiming",
+            ProgramOptions::value<bool>(&replayTiming)->
+                default_value(true),
+            "Issue replayed transactions at their recorded times rather than as fast as possible (default true).")
+            ("sweepStep",
+            ProgramOptions::value<uint64_t>(&sweepStep)->
+                default_value(0),
+            "Find the cluster's capacity: all numClients clients rerun the workload for runTime at a time, adding this many threads (in total over the clients) per step, until sweepSloTx's p99 over all clients exceeds sweepSloP99; writes the sNN.sweep curve (0 for a single run; default 0).")
+            ("sweepMaxThreads",
+            ProgramOptions::value<uint64_t>(&sweepMaxThreads)->
+                default_value(64),
+            "Most threads, in total over the clients, a sweep steps up to (default 64).")
+            ("sweepSloTx",
+            ProgramOptions::value<string>(&sweepSloTx)->
+                default_value("stream"),
+            "Transaction type whose p99 latency the sweep holds to the SLO (default stream).")
+            ("sweepSloP99",
+            ProgramOptions::value<double>(&sweepSloP99)->
+                default_value(1000.0),
+            "p99 latency SLO for the sweep (us; default 1000).")
             ("outputDir",
             ProgramOptions::value<string>(&outputDir)->
                 default_value("./"),
@@ -583,35 +2885,313 @@ try {
             "numClients: %lu\n"
             "numThreads: %lu\n"
             "runTime: %0.2f\n"
+            "warmupTime: %0.2f\n"
+            "cooldownTime: %0.2f\n"
+            "reportInterval: %0.2f\n"
             "streamProb: %0.2f\n"
             "totUsers: %lu\n"
             "streamTxPgSize: %lu\n"
             "workingSetSize: %lu\n"
+            "workloadSpec: %s\n"
+            "numVirtualUsers: %lu\n"
+            "cpuList: %s\n"
+            "numaNodes: %s\n"
+            "threadsPerContext: %lu\n"
+            "perMasterStats: %d\n"
+            "startBarrier: %d\n"
+            "barrierTimeout: %0.2f\n"
             "enableLatLogging: %d\n"
+            "latLogBufferSize: %lu\n"
+            "seed: %lu\n"
+            "recordTrace: %d\n"
+            "replayTrace: %s\n"
+            "replayTiming: %d\n"
+            "sweepStep: %lu\n"
+            "sweepMaxThreads: %lu\n"
+            "sweepSloTx: %s\n"
+            "sweepSloP99: %0.2f\n"
             "outputDir: %s\n",
             clientIndex,
             numClients,
             numThreads,
             runTime,
+            warmupTime,
+            cooldownTime,
+            reportInterval,
             streamProb,
             totUsers,
             streamTxPgSize,
             workingSetSize,
+            workloadSpecFile.c_str(),
+            numVirtualUsers,
+            cpuList.c_str(),
+            numaNodes.c_str(),
+            threadsPerContext,
+            perMasterStats,
+            startBarrier,
+            barrierTimeout,
             enableLatLogging,
+            latLogBufferSize,
+            seed,
+            recordTrace,
+            replayTrace.c_str(),
+            replayTiming,
+            sweepStep,
+            sweepMaxThreads,
+            sweepSloTx.c_str(),
+            sweepSloP99,
             outputDir.c_str());
 
-    uint64_t numLocalThreads = numThreads / numClients;
-    numLocalThreads += ((numThreads % numClients) > clientIndex) ? 1 : 0;
+    if (warmupTime < 0.0 || cooldownTime < 0.0 || warmupTime + cooldownTime >= runTime * 60.0)
+        DIE("warmupTime (%0.2fs) plus cooldownTime (%0.2fs) must be shorter than runTime (%0.2fs)", warmupTime, cooldownTime, runTime * 60.0);
 
-    LOG(NOTICE, "Launching workload threads...");
+    if (threadsPerContext == 0)
+        DIE("threadsPerContext must be at least 1");
 
-    Tub<std::thread> threads[numLocalThreads];
+    workloadSpec spec = defaultWorkloadSpec(streamProb, streamTxPgSize);
+    if (!workloadSpecFile.empty()) {
+        string error;
+        if (!readWorkloadSpec(workloadSpecFile, &spec, &error))
+            DIE("%s", error.c_str());
+    }
+    for (uint64_t t = 0; t < NUM_TX_TYPES; t++) {
+        if (spec.tx[t].enabled)
+            LOG(NOTICE, "Workload mix: %-11s weight %0.3f, pageSize %lu, maxPages %lu, backfill %lu, since %lu, from %lu, to %lu", txTypes[t].specName, spec.tx[t].weight, spec.tx[t].pageSize, spec.tx[t].maxPages, spec.tx[t].backfill, spec.tx[t].since, spec.tx[t].from, spec.tx[t].to);
+        if (numVirtualUsers > 0 && spec.tx[t].weight > 0.0 && t != TX_STREAM && t != TX_TWEET)
+            DIE("numVirtualUsers only supports stream and tweet transactions, not %s", txTypes[t].specName);
+    }
 
-    for (uint64_t i = 0; i < numLocalThreads; i++)
-        threads[i].construct(TwitterWorkloadThread, optionParser, clientIndex, i, runTime, streamProb, totUsers, streamTxPgSize, workingSetSize, enableLatLogging, outputDir);
+    if (seed == 0) {
+        std::random_device randomDevice;
+        seed = ((uint64_t)randomDevice() << 32) | randomDevice();
+        LOG(NOTICE, "Using seed %lu (pass --seed to repeat this run)", seed);
+    }
 
-    for (uint64_t i = 0; i < numLocalThreads; i++)
-        threads[i].get()->join();
+    // Virtual users issue their transactions outside the loop that records
+    // and replays traces.
+    if (recordTrace && numVirtualUsers > 0)
+        DIE("recordTrace does not support numVirtualUsers");
+    if (!replayTrace.empty()) {
+        if (numVirtualUsers > 0)
+            DIE("replayTrace does not support numVirtualUsers");
+        // Any type may appear in a trace. The spec still supplies the
+        // per-type parameters, such as pageSize.
+        for (uint64_t t = 0; t < NUM_TX_TYPES; t++)
+            spec.tx[t].enabled = true;
+    }
+
+    uint64_t sweepSloType = 0;
+    if (sweepStep > 0) {
+        while (sweepSloType < NUM_TX_TYPES && sweepSloTx != txTypes[sweepSloType].specName)
+            sweepSloType++;
+        if (sweepSloType == NUM_TX_TYPES || spec.tx[sweepSloType].weight <= 0.0)
+            DIE("sweepSloTx \"%s\" is not a transaction type in the workload", sweepSloTx.c_str());
+        // A replayed trace would be used up by the first step.
+        if (!replayTrace.empty())
+            DIE("sweepStep cannot be combined with replayTrace");
+        if (numThreads < numClients || numThreads > sweepMaxThreads)
+            DIE("A sweep must start with between numClients (%lu) and sweepMaxThreads (%lu) threads", numClients, sweepMaxThreads);
+    }
+
+    // CPUs to pin the workload threads to, if any, handed out round-robin.
+    std::vector<int> cpus;
+    if (!cpuList.empty()) {
+        if (!parseCpuList(cpuList, &cpus) || cpus.empty())
+            DIE("Bad cpuList \"%s\"", cpuList.c_str());
+    } else if (!numaNodes.empty()) {
+        std::vector<int> nodes;
+        if (!parseCpuList(numaNodes, &nodes) || nodes.empty())
+            DIE("Bad numaNodes \"%s\"", numaNodes.c_str());
+        for (uint64_t i = 0; i < nodes.size(); i++)
+            if (!numaNodeCpus(nodes[i], &cpus))
+                DIE("Could not read the CPUs of NUMA node %d", nodes[i]);
+        if (cpus.empty())
+            DIE("NUMA nodes \"%s\" have no CPUs", numaNodes.c_str());
+    }
+
+    // In sweep mode the workload is rerun with sweepStep more threads in
+    // total each step, into files prefixed with stepNN_, until the p99 of
+    // sweepSloTx exceeds sweepSloP99 or sweepMaxThreads would be passed.
+    // The clients meet at a SWEEPBARRIER counter before each step, and
+    // afterwards exchange their results through the IDTable, so every client
+    // runs the same steps and stops on the same cluster-wide p99. Each step's
+    // cluster throughput and latency go to the sNN.sweep curve; the knee is
+    // the last step within the SLO.
+    std::ofstream sweepFile;
+    Tub<RamCloud> sweepClient;
+    uint64_t sweepIdTableId = 0;
+    if (sweepStep > 0) {
+        sweepClient.construct(&context,
+                optionParser.options.getCoordinatorLocator().c_str(),
+                optionParser.options.getClusterName().c_str());
+        sweepIdTableId = sweepClient->getTableId("IDTable");
+        string sweepFileName = format("%ss%02lu.sweep", outputDir.c_str(), clientIndex);
+        LOG(NOTICE, "Recording sweep curve in file %s", sweepFileName.c_str());
+        sweepFile.open(sweepFileName.c_str());
+        sweepFile << format(SWEEPFILE_HDRFMTSTR, "#THREADS", "TPUT(tx/s)", "SLOTPUT(tx/s)", "AVG(us)", "P50(us)", "P99(us)", "P999(us)", "MAX(us)");
+    }
+    uint64_t kneeThreads = 0;
+    double kneeThroughput = 0.0;
+    double kneeP99 = 0.0;
+
+    for (uint64_t step = 0; ; step++) {
+        uint64_t numLocalThreads = numThreads / numClients;
+        numLocalThreads += ((numThreads % numClients) > clientIndex) ? 1 : 0;
+
+        string stepOutputDir = outputDir;
+        RCDB::ProtoBuf::IDTableKey barrierKey;
+        barrierKey.set_type(RCDB::ProtoBuf::IDTableKey::BARRIER);
+        uint64_t sweepRound = 0;
+        if (sweepStep > 0) {
+            stepOutputDir = format("%sstep%02lu_", outputDir.c_str(), step);
+            RCDB::ProtoBuf::IDTableKey stepKey;
+            stepKey.set_type(RCDB::ProtoBuf::IDTableKey::SWEEPBARRIER);
+            stepKey.set_step(step);
+            sweepRound = waitAtBarrier(*sweepClient, sweepIdTableId, stepKey.SerializeAsString(), numClients, barrierTimeout, format("Sweep(s%02lu)", clientIndex));
+            // The step's own start barrier, which starts from zero.
+            barrierKey.set_step(step);
+            barrierKey.set_round(sweepRound);
+            LOG(NOTICE, "Sweep step %lu: %lu threads (%lu on this client)", step, numThreads, numLocalThreads);
+        }
+
+        // Clients shared by groups of threadsPerContext threads. Each has a
+        // dedicated dispatch thread, which is not pinned and which spins on a
+        // core of its own; the summaries report how many there are.
+        uint64_t numContexts = (threadsPerContext > 1) ? (numLocalThreads + threadsPerContext - 1) / threadsPerContext : 0;
+        Tub<Context> sharedContexts[numContexts];
+        Tub<RamCloud> sharedClients[numContexts];
+        for (uint64_t i = 0; i < numContexts; i++) {
+            LOG(NOTICE, "Connecting shared client %lu to coordinator at %s", i, optionParser.options.getCoordinatorLocator().c_str());
+            sharedContexts[i].construct(true);
+            sharedClients[i].construct(sharedContexts[i].get(),
+                    optionParser.options.getCoordinatorLocator().c_str(),
+                    optionParser.options.getClusterName().c_str());
+        }
+
+        // Per-thread binary latency logs, drained to disk by one background
+        // writer so that the workload threads never touch the file themselves.
+        Tub<RCDB::LatencyLog> latLogs[numLocalThreads];
+        std::vector<RCDB::LatencyLog*> latLogPtrs;
+        Tub<RCDB::LatencyLogWriter> latLogWriter;
+        if (enableLatLogging) {
+            RCDB::LatencyLogHeader latLogHeader;
+            memset(&latLogHeader, 0, sizeof(latLogHeader));
+            latLogHeader.cyclesPerSec = Cycles::perSecond();
+            struct timespec now;
+            clock_gettime(CLOCK_REALTIME, &now);
+            latLogHeader.startCycles = Cycles::rdtsc();
+            latLogHeader.startWallTimeNs = (uint64_t)now.tv_sec * 1000000000UL + (uint64_t)now.tv_nsec;
+            latLogHeader.serverNumber = clientIndex;
+
+            for (uint64_t i = 0; i < numLocalThreads; i++) {
+                string latFileName = format("%ss%02lu_t%02lu.blat", stepOutputDir.c_str(), clientIndex, i);
+                LOG(NOTICE, "Recording latency measurements for thread %lu in file %s", i, latFileName.c_str());
+                latLogHeader.threadNumber = i;
+                latLogs[i].construct(latFileName, latLogHeader, latLogBufferSize);
+                if (!latLogs[i]->isOpen())
+                    DIE("Could not open latency log file %s", latFileName.c_str());
+                latLogPtrs.push_back(latLogs[i].get());
+            }
+            latLogWriter.construct(latLogPtrs);
+        }
+
+        // Per-thread transaction traces to record or replay.
+        Tub<RCDB::TxTraceWriter> traceWriters[numLocalThreads];
+        Tub<RCDB::TxTraceReader> traceReaders[numLocalThreads];
+        for (uint64_t i = 0; i < numLocalThreads; i++) {
+            if (recordTrace) {
+                string traceFileName = format("%ss%02lu_t%02lu.trc", stepOutputDir.c_str(), clientIndex, i);
+                LOG(NOTICE, "Recording transaction trace for thread %lu in file %s", i, traceFileName.c_str());
+                RCDB::TxTraceHeader traceHeader;
+                memset(&traceHeader, 0, sizeof(traceHeader));
+                struct timespec now;
+                clock_gettime(CLOCK_REALTIME, &now);
+                traceHeader.startWallTimeNs = (uint64_t)now.tv_sec * 1000000000UL + (uint64_t)now.tv_nsec;
+                traceHeader.serverNumber = clientIndex;
+                traceHeader.threadNumber = i;
+                traceWriters[i].construct(traceFileName, traceHeader);
+                if (!traceWriters[i]->isOpen())
+                    DIE("Could not open trace file %s", traceFileName.c_str());
+            }
+            if (!replayTrace.empty()) {
+                string traceFileName = format("%s/s%02lu_t%02lu.trc", replayTrace.c_str(), clientIndex, i);
+                string error;
+                LOG(NOTICE, "Replaying transaction trace %s on thread %lu", traceFileName.c_str(), i);
+                traceReaders[i].construct(traceFileName, &error);
+                if (!traceReaders[i]->isOpen())
+                    DIE("%s", error.c_str());
+            }
+        }
+
+        LOG(NOTICE, "Launching workload threads...");
+
+        Tub<std::thread> threads[numLocalThreads];
+        std::vector<threadResult> results(numLocalThreads);
+
+        for (uint64_t i = 0; i < numLocalThreads; i++)
+            threads[i].construct(TwitterWorkloadThread, std::ref(optionParser), clientIndex, i, cpus.empty() ? -1 : cpus[i % cpus.size()], numContexts > 0 ? sharedClients[i / threadsPerContext].get() : NULL, runTime, warmupTime, cooldownTime, reportInterval, std::cref(spec), totUsers, workingSetSize, numVirtualUsers, perMasterStats, barrierKey.SerializeAsString(), startBarrier ? numThreads : 0, barrierTimeout, enableLatLogging ? latLogs[i].get() : NULL, seed, traceWriters[i].get(), traceReaders[i].get(), replayTiming, stepOutputDir, &results[i]);
+
+        for (uint64_t i = 0; i < numLocalThreads; i++)
+            threads[i].get()->join();
+
+        // Combine the threads' statistics into one summary for this client.
+        // Percentiles come from the merged histograms, not from averaging.
+        threadResult clientResult;
+        for (uint64_t i = 0; i < numLocalThreads; i++)
+            clientResult.merge(results[i]);
+        clientResult.dispatchThreads = numContexts;
+
+        string datFileName = format("%ss%02lu.dat", stepOutputDir.c_str(), clientIndex);
+        LOG(NOTICE, "Recording client summary in file %s", datFileName.c_str());
+        writeSummary(datFileName, clientResult, spec);
+
+        string sumFileName = format("%ss%02lu.sum", stepOutputDir.c_str(), clientIndex);
+        string tsFileName = format("%ss%02lu.ts", stepOutputDir.c_str(), clientIndex);
+        LOG(NOTICE, "Recording mergeable client summary in file %s", sumFileName.c_str());
+        if (!writeRunSummary(sumFileName, tsFileName, clientResult, spec, numLocalThreads))
+            LOG(ERROR, "Could not write %s", sumFileName.c_str());
+
+        // Flush whatever the writer has not yet drained.
+        latLogWriter.destroy();
+        for (uint64_t i = 0; i < numLocalThreads; i++) {
+            if (latLogs[i] && latLogs[i]->getDropped() > 0)
+                LOG(WARNING, "Latency log for thread %lu dropped %lu of %lu records; consider a larger latLogBufferSize", i, latLogs[i]->getDropped(), latLogs[i]->getDropped() + latLogs[i]->getWritten());
+        }
+
+        if (sweepStep == 0)
+            break;
+
+        RCDB::LatencyHistogram sloHist = clientResult.stats.txHist[sweepSloType];
+        double throughput = 0.0;
+        for (uint64_t t = 0; t < NUM_TX_TYPES; t++)
+            throughput += clientResult.txThroughput[t];
+        double sloThroughput = clientResult.txThroughput[sweepSloType];
+        exchangeSweepResults(*sweepClient, sweepIdTableId, step, sweepRound, clientIndex, numClients, barrierTimeout, &throughput, &sloThroughput, &sloHist);
+        double p99 = (double)sloHist.getPercentile(0.99) / 1000.0;
+        sweepFile << format(SWEEPFILE_ENTFMTSTR, numThreads, throughput, sloThroughput, sloHist.getMean() / 1000.0, (double)sloHist.getPercentile(0.5) / 1000.0, p99, (double)sloHist.getPercentile(0.999) / 1000.0, (double)sloHist.getMax() / 1000.0);
+        sweepFile.flush();
+        LOG(NOTICE, "Sweep step %lu: %lu threads, %0.2f tx/s, %s p99 %0.2fus (SLO %0.2fus) over %lu clients", step, numThreads, throughput, txTypes[sweepSloType].specName, p99, sweepSloP99, numClients);
+
+        if (p99 > sweepSloP99)
+            break;
+        kneeThreads = numThreads;
+        kneeThroughput = throughput;
+        kneeP99 = p99;
+        if (numThreads + sweepStep > sweepMaxThreads)
+            break;
+        numThreads += sweepStep;
+    }
+
+    if (sweepStep > 0) {
+        if (kneeThreads > 0) {
+            LOG(NOTICE, "Sweep knee: %lu threads, %0.2f tx/s, %s p99 %0.2fus", kneeThreads, kneeThroughput, txTypes[sweepSloType].specName, kneeP99);
+            sweepFile << format("# KNEE: %lu threads, %0.2f tx/s, %s p99 %0.2fus\n", kneeThreads, kneeThroughput, txTypes[sweepSloType].specName, kneeP99);
+        } else {
+            LOG(WARNING, "Sweep: the first step already exceeds the SLO");
+            sweepFile << "# KNEE: none, the first step exceeds the SLO\n";
+        }
+        sweepFile.close();
+    }
 
     return 0;
 } catch (RAMCloud::ClientException& e) {
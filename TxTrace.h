@@ -0,0 +1,171 @@
+/* Copyright (c) 2009-2014 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RCDB_TXTRACE_H
+#define RCDB_TXTRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+/*
+ * Binary trace of the transactions a workload thread issued, written with
+ * --recordTrace and reissued with --replayTrace. A trace is a
+ * TxTraceHeader followed by TxTraceRecords in issue order, all in host byte
+ * order. Traces captured elsewhere can be replayed by writing them in this
+ * format: records need only be sorted by offsetNs, and type, userId, arg and
+ * arg2 mean the same as in the client's txRequest.
+ */
+
+namespace RCDB {
+
+#define TXTRACE_MAGIC "RCDBTXT"
+#define TXTRACE_VERSION 2
+
+struct TxTraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    /// Wall clock time (ns since the epoch) the trace started; informational.
+    uint64_t startWallTimeNs;
+    uint64_t serverNumber;
+    uint64_t threadNumber;
+};
+
+struct TxTraceRecord {
+    /// Time the transaction was issued, in ns since the trace started.
+    uint64_t offsetNs;
+    uint64_t userId;
+    uint64_t arg;
+    uint64_t arg2;
+    /// One of the LatencyLogTxType values.
+    uint32_t type;
+    uint32_t reserved;
+};
+
+/**
+ * Appends records to a trace file. Writes go through a large stdio buffer,
+ * so appending is a memcpy except when the buffer fills; unlike LatencyLog
+ * nothing is ever dropped, since a trace with holes cannot be replayed.
+ */
+class TxTraceWriter {
+  public:
+    /**
+     * \param fileName
+     *      File to write; truncated if it exists.
+     * \param header
+     *      Header to write at the start of the file; magic, version and
+     *      recordSize are filled in here.
+     */
+    TxTraceWriter(const std::string& fileName, TxTraceHeader header)
+        : file(fopen(fileName.c_str(), "w"))
+        , count(0)
+    {
+        if (file == NULL)
+            return;
+        setvbuf(file, NULL, _IOFBF, 1 << 20);
+        memcpy(header.magic, TXTRACE_MAGIC, sizeof(header.magic));
+        header.version = TXTRACE_VERSION;
+        header.recordSize = sizeof(TxTraceRecord);
+        fwrite(&header, sizeof(header), 1, file);
+    }
+
+    ~TxTraceWriter()
+    {
+        if (file != NULL)
+            fclose(file);
+    }
+
+    /// False if the file could not be opened.
+    bool isOpen() const { return file != NULL; }
+
+    void
+    append(const TxTraceRecord& record)
+    {
+        if (file != NULL)
+            fwrite(&record, sizeof(record), 1, file);
+        count++;
+    }
+
+    /// Records appended so far.
+    uint64_t getCount() const { return count; }
+
+  private:
+    FILE* file;
+    uint64_t count;
+
+    TxTraceWriter(const TxTraceWriter&);
+    TxTraceWriter& operator=(const TxTraceWriter&);
+};
+
+/**
+ * Reads the records of a trace file in order.
+ */
+class TxTraceReader {
+  public:
+    /**
+     * \param[out] error
+     *      Set to a description of the problem if the trace cannot be read;
+     *      isOpen() then returns false.
+     */
+    TxTraceReader(const std::string& fileName, std::string* error)
+        : file(fopen(fileName.c_str(), "r"))
+        , header()
+    {
+        if (file == NULL) {
+            *error = "could not open " + fileName;
+            return;
+        }
+        setvbuf(file, NULL, _IOFBF, 1 << 20);
+        if (fread(&header, sizeof(header), 1, file) != 1 ||
+                memcmp(header.magic, TXTRACE_MAGIC,
+                        strlen(TXTRACE_MAGIC)) != 0 ||
+                header.version != TXTRACE_VERSION ||
+                header.recordSize != sizeof(TxTraceRecord)) {
+            *error = fileName + " is not a supported transaction trace";
+            fclose(file);
+            file = NULL;
+        }
+    }
+
+    ~TxTraceReader()
+    {
+        if (file != NULL)
+            fclose(file);
+    }
+
+    bool isOpen() const { return file != NULL; }
+
+    const TxTraceHeader& getHeader() const { return header; }
+
+    /// Read the next record. Returns false at the end of the trace.
+    bool
+    next(TxTraceRecord* record)
+    {
+        return file != NULL && fread(record, sizeof(*record), 1, file) == 1;
+    }
+
+  private:
+    FILE* file;
+    TxTraceHeader header;
+
+    TxTraceReader(const TxTraceReader&);
+    TxTraceReader& operator=(const TxTraceReader&);
+};
+
+} // namespace RCDB
+
+#endif // RCDB_TXTRACE_H